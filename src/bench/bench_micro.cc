@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <boost/program_options.hpp>
+
+#include "board/board.hh"
+#include "evaluator/evaluate.hh"
+#include "move_generator/move_generator.hh"
+#include "search/alloc_count.hh"
+#include "search/cache.hh"
+
+// Nanoseconds per call of the board and move generation primitives, over a
+// set of positions. Each benchmark is run in batches long enough to time
+// reliably, and the spread over the batches is reported alongside the median
+// so a regression can be told apart from noise.
+
+namespace po = boost::program_options;
+
+namespace {
+
+// Results are folded in here so the compiler can't drop the work
+volatile uint64_t sink;
+
+struct BenchOptions {
+  int repetitions{15};
+  double batch_ms{20};
+  std::string filter;
+};
+
+// f does ops_per_call operations and returns something derived from them
+void bench(const BenchOptions& options, const std::string& name, size_t ops_per_call,
+           const std::function<uint64_t()>& f) {
+  if(!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+
+  using Clock = std::chrono::steady_clock;
+  auto timeCalls = [&](size_t calls) {
+    uint64_t result = 0;
+    auto start = Clock::now();
+    for(size_t i = 0; i < calls; ++i) result += f();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    sink = sink + result;
+    return ns;
+  };
+
+  // Warm up, then double the batch until it takes long enough to time
+  size_t calls = 1;
+  while(timeCalls(calls) < options.batch_ms * 1e6 && calls < (size_t(1) << 30)) calls *= 2;
+
+  const uint64_t allocations = chess::threadAllocCounts().allocations;
+  std::vector<double> ns_per_op;
+  for(int r = 0; r < options.repetitions; ++r)
+    ns_per_op.push_back(timeCalls(calls) / (calls * ops_per_call));
+  double allocs_per_op = double(chess::threadAllocCounts().allocations - allocations)
+                         / (double(options.repetitions) * calls * ops_per_call);
+  std::sort(ns_per_op.begin(), ns_per_op.end());
+
+  double mean = 0;
+  for(double x : ns_per_op) mean += x;
+  mean /= ns_per_op.size();
+  double var = 0;
+  for(double x : ns_per_op) var += (x - mean) * (x - mean);
+  double stddev = std::sqrt(var / std::max<size_t>(ns_per_op.size() - 1, 1));
+
+  fmt::print("{:<28} {:>10.1f} {:>10.1f} {:>10.1f} {:>8.1f}% {:>10.2f}\n", name, ns_per_op.front(),
+             ns_per_op[ns_per_op.size() / 2], mean, 100 * stddev / std::max(mean, 1e-9), allocs_per_op);
+}
+
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> fnames;
+  std::string config_dir = CHESS_CONFIG_DIR;
+  BenchOptions options;
+
+  po::options_description desc{"Options"};
+  desc.add_options()
+    ("board-file,b", po::value<std::vector<std::string>>(&fnames), "Files with board desc (default: everything in --config)")
+    ("config", po::value<std::string>(&config_dir), "Directory of board files")
+    ("reps", po::value<int>(&options.repetitions), "Timed batches per benchmark")
+    ("batch-ms", po::value<double>(&options.batch_ms), "Rough length of one batch")
+    ("filter", po::value<std::string>(&options.filter), "Only run benchmarks whose name contains this");
+
+  po::positional_options_description positional;
+  positional.add("board-file", -1);
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+  po::notify(vm);
+
+  if(fnames.empty()) {
+    for(const auto& entry : std::filesystem::directory_iterator(config_dir))
+      if(entry.is_regular_file()) fnames.push_back(entry.path().string());
+    std::sort(fnames.begin(), fnames.end());
+  }
+
+  // Positions without both kings would send inCheck off the board
+  std::vector<chess::Board> boards;
+  for(const auto& fname : fnames) {
+    chess::Board board(fname);
+    if(board.hasBothKings()) boards.push_back(board);
+  }
+  if(boards.empty()) {
+    std::cerr << "No usable positions" << std::endl;
+    return 1;
+  }
+
+  // What doMove and the cache benchmarks replay
+  std::vector<std::pair<chess::Board, chess::Color>> positions;
+  std::vector<std::pair<size_t, chess::Move>> moves;
+  for(const auto& board : boards) {
+    for(chess::Color color : {chess::Color::WHITE, chess::Color::BLACK}) {
+      chess::MoveGenerator move_gen(board);
+      for(const auto& m : move_gen.getMovesForPlayer(color)) moves.emplace_back(positions.size(), m);
+      positions.emplace_back(board, color);
+    }
+  }
+
+#ifndef __OPTIMIZE__
+  fmt::print("Warning: built without optimization, configure with -DCMAKE_BUILD_TYPE=Release\n");
+#endif
+  fmt::print("{} positions, {} moves\n\n", boards.size(), moves.size());
+  fmt::print("{:<28} {:>10} {:>10} {:>10} {:>9} {:>10}\n", "ns/op", "min", "median", "mean", "stddev",
+             "allocs/op");
+
+  const size_t num_squares = boards.size() * kBoardDim * kBoardDim;
+
+  bench(options, "Board::getPieceAt", num_squares, [&]() {
+    uint64_t result = 0;
+    for(const auto& board : boards)
+      for(uint8_t file = 0; file < kBoardDim; ++file)
+        for(uint8_t rank = 0; rank < kBoardDim; ++rank)
+          result += board.getPieceAt(file, rank);
+    return result;
+  });
+
+  std::vector<chess::Board> scratch = boards;
+  bench(options, "Board::setPieceAt", num_squares, [&]() {
+    uint64_t result = 0;
+    for(size_t i = 0; i < boards.size(); ++i) {
+      for(uint8_t file = 0; file < kBoardDim; ++file)
+        for(uint8_t rank = 0; rank < kBoardDim; ++rank)
+          scratch[i].setPieceAt(file, rank, boards[i].getPieceAt(7 - file, rank));
+      result += scratch[i].getPieceAt(0, 0);
+    }
+    return result;
+  });
+
+  bench(options, "Board::posAttacked", num_squares, [&]() {
+    uint64_t result = 0;
+    for(const auto& board : boards)
+      for(uint8_t file = 0; file < kBoardDim; ++file)
+        for(uint8_t rank = 0; rank < kBoardDim; ++rank)
+          result += board.posAttacked(file, rank, chess::Color::WHITE);
+    return result;
+  });
+
+  bench(options, "Board::inCheck", positions.size(), [&]() {
+    uint64_t result = 0;
+    for(const auto& [board, color] : positions) result += board.inCheck(color);
+    return result;
+  });
+
+  bench(options, "Board::doMove", moves.size(), [&]() {
+    uint64_t result = 0;
+    chess::Board child;
+    for(const auto& [index, m] : moves)
+      result += positions[index].first.doMove(m, positions[index].second, &child);
+    return result;
+  });
+
+  bench(options, "Board::makeMove", moves.size(), [&]() {
+    uint64_t result = 0;
+    for(const auto& [index, m] : moves) {
+      chess::Board child = positions[index].first;
+      child.makeMove(m, positions[index].second);
+      result += child.special_move_flags_;
+    }
+    return result;
+  });
+
+  bench(options, "Board::computeHash", boards.size(), [&]() {
+    uint64_t result = 0;
+    for(const auto& board : boards) result += board.computeHash();
+    return result;
+  });
+
+  bench(options, "Board::computeSDBMHash", boards.size(), [&]() {
+    uint64_t result = 0;
+    for(const auto& board : boards) result += board.computeSDBMHash();
+    return result;
+  });
+
+  bench(options, "Board::computeDJB2Hash", boards.size(), [&]() {
+    uint64_t result = 0;
+    for(const auto& board : boards) result += board.computeDJB2Hash();
+    return result;
+  });
+
+  bench(options, "getMovesForPlayer", positions.size(), [&]() {
+    uint64_t result = 0;
+    for(const auto& [board, color] : positions) {
+      chess::MoveGenerator move_gen(board);
+      result += move_gen.getMovesForPlayer(color).size();
+    }
+    return result;
+  });
+
+  bench(options, "Evaluator::operator()", positions.size(), [&]() {
+    uint64_t result = 0;
+    for(const auto& [board, color] : positions) {
+      chess::Evaluator eval(board);
+      result += eval(color).state;
+    }
+    return result;
+  });
+
+  chess::Cache cache;
+  for(const auto& [board, color] : positions) {
+    chess::MoveGenerator move_gen(board);
+    cache.insert(board, color, move_gen.getMovesForPlayer(color));
+  }
+  bench(options, "Cache::getMoveList (hit)", positions.size(), [&]() {
+    uint64_t result = 0;
+    chess::MoveList list;
+    for(const auto& [board, color] : positions) {
+      cache.getMoveList(board, color, &list);
+      result += list.size();
+    }
+    return result;
+  });
+
+  chess::Cache empty_cache;
+  bench(options, "Cache::contains (miss)", positions.size(), [&]() {
+    uint64_t result = 0;
+    for(const auto& [board, color] : positions) result += empty_cache.contains(board, color);
+    return result;
+  });
+
+  return 0;
+}
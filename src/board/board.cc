@@ -1,6 +1,7 @@
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <cstdlib>
 
 #include "board/board.hh"
 #include "board/board_utils.hh"
@@ -27,6 +28,64 @@ std::string Move::str() const {
                          end_file, end_rank, promote_str);
 }
 
+std::string Move::uci(Color color) const {
+  const std::string home = color == Color::WHITE ? "1" : "8";
+  if(king_castle) return "e" + home + "g" + home;
+  if(queen_castle) return "e" + home + "c" + home;
+
+  std::string result = kFileNames[start_file] + kRankNames[start_rank]
+                     + kFileNames[end_file] + kRankNames[end_rank];
+  switch(promotes_to) {
+    case PieceType::ROOK: result += 'r'; break;
+    case PieceType::BISHOP: result += 'b'; break;
+    case PieceType::KNIGHT: result += 'n'; break;
+    case PieceType::QUEEN: result += 'q'; break;
+    default: break;
+  }
+  return result;
+}
+
+PackedMove Move::pack() const {
+  uint16_t flags = 0;
+  if(king_castle) flags = 2;
+  else if(queen_castle) flags = 3;
+  else if(is_en_passant) flags = 4;
+  else if(promotes_to != PieceType::NONE_TYPE) flags = 0b1000 | (promotes_to - PieceType::ROOK);
+  else if(en_passant_flags != 0) flags = 1;
+
+  uint16_t start = start_file*kBoardDim + start_rank;
+  uint16_t end = end_file*kBoardDim + end_rank;
+  return (flags << 12) | (end << 6) | start;
+}
+
+Move Move::unpack(PackedMove packed) {
+  uint8_t start = packed & 0x3F;
+  uint8_t end = (packed >> 6) & 0x3F;
+  uint8_t flags = packed >> 12;
+
+  Move result(start / kBoardDim, start % kBoardDim, end / kBoardDim, end % kBoardDim);
+  switch(flags) {
+    case 0:
+      break;
+    case 1:
+      result.en_passant_flags = 0b1000 | result.end_file;
+      break;
+    case 2:
+      result.king_castle = true;
+      break;
+    case 3:
+      result.queen_castle = true;
+      break;
+    case 4:
+      result.is_en_passant = true;
+      break;
+    default:
+      result.promotes_to = static_cast<PieceType>((flags & 0b111) + PieceType::ROOK);
+      break;
+  }
+  return result;
+}
+
 Board::Board() {
   for(auto& b : data_) b = 0;
 }
@@ -61,6 +120,194 @@ void Board::setBoardFromFile(const std::string& fname) {
   setBoard(buffer.str());
 }
 
+// FEN letter for each Piece value, '?' where there's no such piece
+static constexpr char kFenPieceChars[] = " PRBNQK??prbnqk?";
+
+static Piece pieceFromFenChar(char c) {
+  switch(c) {
+    case 'P': return Piece::WHITE_PAWN;
+    case 'R': return Piece::WHITE_ROOK;
+    case 'B': return Piece::WHITE_BISHOP;
+    case 'N': return Piece::WHITE_KNIGHT;
+    case 'Q': return Piece::WHITE_QUEEN;
+    case 'K': return Piece::WHITE_KING;
+    case 'p': return Piece::BLACK_PAWN;
+    case 'r': return Piece::BLACK_ROOK;
+    case 'b': return Piece::BLACK_BISHOP;
+    case 'n': return Piece::BLACK_KNIGHT;
+    case 'q': return Piece::BLACK_QUEEN;
+    case 'k': return Piece::BLACK_KING;
+    default: return Piece::NONE;
+  }
+}
+
+static bool isFenSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Next whitespace separated field of s, starting at *pos
+static std::string_view nextFenField(std::string_view s, size_t* pos) {
+  while(*pos < s.size() && isFenSpace(s[*pos])) ++*pos;
+  size_t start = *pos;
+  while(*pos < s.size() && !isFenSpace(s[*pos])) ++*pos;
+  return s.substr(start, *pos - start);
+}
+
+static bool isNumber(std::string_view s) {
+  return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// The four fields FEN and EPD share. Leaves *pos after them.
+static bool parseFenPosition(std::string_view s, size_t* pos, Board* board, Color* player) {
+  std::string_view placement = nextFenField(s, pos);
+  int file = 0;
+  int rank = kBoardDim - 1;
+  for(char c : placement) {
+    if(c == '/') {
+      if(file != kBoardDim || rank == 0) return false;
+      file = 0;
+      --rank;
+    } else if(c >= '1' && c <= '8') {
+      file += c - '0';
+      if(file > static_cast<int>(kBoardDim)) return false;
+    } else {
+      Piece piece = pieceFromFenChar(c);
+      if(piece == Piece::NONE || file >= static_cast<int>(kBoardDim)) return false;
+      board->setPieceAt(file++, rank, piece);
+    }
+  }
+  if(file != kBoardDim || rank != 0) return false;
+
+  std::string_view side = nextFenField(s, pos);
+  if(side == "w") *player = Color::WHITE;
+  else if(side == "b") *player = Color::BLACK;
+  else return false;
+
+  std::string_view castling = nextFenField(s, pos);
+  board->special_move_flags_ = 0;
+  if(castling != "-") {
+    for(char c : castling) {
+      switch(c) {
+        case 'K': board->special_move_flags_ |= kWhiteKingCastleMask; break;
+        case 'Q': board->special_move_flags_ |= kWhiteQueenCastleMask; break;
+        case 'k': board->special_move_flags_ |= kBlackKingCastleMask; break;
+        case 'q': board->special_move_flags_ |= kBlackQueenCastleMask; break;
+        default: return false;
+      }
+    }
+  }
+
+  // The square behind the pawn that just moved two, so on the mover's third rank
+  std::string_view en_passant = nextFenField(s, pos);
+  if(en_passant != "-") {
+    const char rank_char = *player == Color::WHITE ? '6' : '3';
+    if(en_passant.size() != 2 || en_passant[0] < 'a' || en_passant[0] > 'h'
+       || en_passant[1] != rank_char)
+      return false;
+    board->special_move_flags_ |= kCanEnPassantMask | ((en_passant[0] - 'a') << 4);
+  }
+  return true;
+}
+
+bool Board::setFen(std::string_view fen, Color* player) {
+  Board board;
+  Color side;
+  size_t pos = 0;
+  if(!parseFenPosition(fen, &pos, &board, &side)) return false;
+
+  // Halfmove and fullmove clocks, optional
+  for(int i = 0; i < 2; ++i) {
+    std::string_view clock = nextFenField(fen, &pos);
+    if(clock.empty()) break;
+    if(!isNumber(clock)) return false;
+  }
+  if(!nextFenField(fen, &pos).empty()) return false;
+
+  *this = board;
+  *player = side;
+  return true;
+}
+
+bool Board::setEpd(std::string_view epd, Color* player, std::string_view* operations) {
+  Board board;
+  Color side;
+  size_t pos = 0;
+  if(!parseFenPosition(epd, &pos, &board, &side)) return false;
+
+  *this = board;
+  *player = side;
+  if(operations != nullptr) {
+    while(pos < epd.size() && isFenSpace(epd[pos])) ++pos;
+    size_t end = epd.size();
+    while(end > pos && isFenSpace(epd[end - 1])) --end;
+    *operations = epd.substr(pos, end - pos);
+  }
+  return true;
+}
+
+size_t Board::writeFen(Color player, char* out, bool epd) const {
+  char* p = out;
+  for(int rank = kBoardDim - 1; rank >= 0; --rank) {
+    int empty = 0;
+    for(uint8_t file = 0; file < kBoardDim; ++file) {
+      Piece piece = getPieceAt(file, rank);
+      if(piece == Piece::NONE) {
+        ++empty;
+        continue;
+      }
+      if(empty > 0) *p++ = '0' + empty;
+      empty = 0;
+      *p++ = kFenPieceChars[piece];
+    }
+    if(empty > 0) *p++ = '0' + empty;
+    if(rank > 0) *p++ = '/';
+  }
+
+  *p++ = ' ';
+  *p++ = player == Color::WHITE ? 'w' : 'b';
+
+  *p++ = ' ';
+  const char* castling_start = p;
+  if(special_move_flags_ & kWhiteKingCastleMask) *p++ = 'K';
+  if(special_move_flags_ & kWhiteQueenCastleMask) *p++ = 'Q';
+  if(special_move_flags_ & kBlackKingCastleMask) *p++ = 'k';
+  if(special_move_flags_ & kBlackQueenCastleMask) *p++ = 'q';
+  if(p == castling_start) *p++ = '-';
+
+  *p++ = ' ';
+  if(special_move_flags_ & kCanEnPassantMask) {
+    *p++ = 'a' + ((special_move_flags_ & kEnPassantFileMask) >> 4);
+    *p++ = player == Color::WHITE ? '6' : '3';
+  } else {
+    *p++ = '-';
+  }
+
+  // The board doesn't keep the clocks
+  if(!epd) {
+    for(char c : std::string_view(" 0 1")) *p++ = c;
+  }
+
+  *p = '\0';
+  return p - out;
+}
+
+std::string Board::fen(Color player) const {
+  char buffer[kMaxFenLength];
+  size_t length = writeFen(player, buffer);
+  return std::string(buffer, length);
+}
+
+bool Board::hasBothKings() const {
+  int white = 0, black = 0;
+  for(uint8_t file = 0; file < kBoardDim; ++file) {
+    for(uint8_t rank = 0; rank < kBoardDim; ++rank) {
+      white += getPieceAt(file, rank) == Piece::WHITE_KING;
+      black += getPieceAt(file, rank) == Piece::BLACK_KING;
+    }
+  }
+  return white == 1 && black == 1;
+}
+
 Piece Board::getPieceAt(uint8_t file, uint8_t rank) const {
   uint8_t bit_index = (file*kBoardDim + rank)*kBitsPerPiece;
 
@@ -247,11 +494,14 @@ bool Board::posAttacked(uint8_t file, uint8_t rank, const Color color,
         // The rank a pawn goes TO during EP capture
         uint8_t ep_rank = attacker_color == Color::WHITE? 5 : 2;
 
-        if(file > 0 && getPieceAt(file-1, ep_rank-pawn_dir) == pawn_piece) {
-          ADD_OR_RETURN(file-1, ep_rank-pawn_dir);
-        }
-        if(file < kBoardDim - 1 && getPieceAt(file+1, ep_rank-pawn_dir) == pawn_piece) {
-          ADD_OR_RETURN(file+1, ep_rank-pawn_dir);
+        // Only the square behind the pawn that just moved two can be taken this way
+        if(file == ep_file && rank == ep_rank) {
+          if(file > 0 && getPieceAt(file-1, ep_rank-pawn_dir) == pawn_piece) {
+            ADD_OR_RETURN(file-1, ep_rank-pawn_dir);
+          }
+          if(file < kBoardDim - 1 && getPieceAt(file+1, ep_rank-pawn_dir) == pawn_piece) {
+            ADD_OR_RETURN(file+1, ep_rank-pawn_dir);
+          }
         }
       }
     }
@@ -359,76 +609,232 @@ bool Board::doMove(Move move, Color color, Board* result, int* cap_value) {
   return doMove(move, color, {}, result, cap_value);
 }
 bool Board::doMove(Move move, Color color, CachePtr cache, Board* result, int* cap_value) {
+  if(cap_value != nullptr) {
+    bool is_castle = move.king_castle || move.queen_castle;
+    *cap_value = is_castle ? 0 : kPieceVals[getPieceType(getPieceAt(move.end_file, move.end_rank))];
+  }
+
   Board tmp_board = *this;
+  tmp_board.makeMove(move, color);
+
+  if(tmp_board.inCheck(color, cache)) {
+    return false;
+  }
 
-  bool just_castled = false;
+  if(result == nullptr) {
+    *this = tmp_board;
+  } else {
+    *result = tmp_board;
+  }
+  return true;
+}
 
+void Board::makeMove(const Move& move, Color color) {
   int back_rank = color == Color::WHITE? 0 : 7;
-    
 
   const int castle_mask_shift = color == Color::WHITE? 0 : 2;
 
   // Case 1: Castle. We verified before that none of the positions are in check or occupied.
-  if(move.queen_castle) {
-    tmp_board.movePiece(4, back_rank, 2, back_rank); 
-    tmp_board.movePiece(0, back_rank, 3, back_rank);
-    just_castled = true;
-  } else if (move.king_castle) {
-    tmp_board.movePiece(4, back_rank, 6, back_rank); 
-    tmp_board.movePiece(7, back_rank, 5, back_rank);
-    just_castled = true;
-  } 
-
-  // Not a castle
-  else {
-    PieceType captured_type = getPieceType(getPieceAt(move.end_file, move.end_rank));
-    if(cap_value != nullptr) {
-      *cap_value = kPieceVals[captured_type];
-    }
-   
-    // If we're about to move a king, no more castling.
-    if(getPieceType(getPieceAt(move.start_file, move.start_rank)) == PieceType::KING) {
-      tmp_board.special_move_flags_ = tmp_board.special_move_flags_ & ~(0b11 << castle_mask_shift);
-    }
-
-    
-    // If we're about to move the H rook, no more king-side castles.
-    // No need to check if it's a rook since moving any piece there means we disabled at some point.
-    if(move.start_file == 7 && move.start_rank == back_rank){
-      tmp_board.special_move_flags_ = tmp_board.special_move_flags_ & ~(0b10 << castle_mask_shift); 
-    } else if (move.start_file == 0 && move.start_rank == back_rank) { // same for queen
-      tmp_board.special_move_flags_ = tmp_board.special_move_flags_ & ~(0b1 << castle_mask_shift); 
+  if(move.queen_castle || move.king_castle) {
+    if(move.queen_castle) {
+      movePiece(4, back_rank, 2, back_rank); 
+      movePiece(0, back_rank, 3, back_rank);
+    } else {
+      movePiece(4, back_rank, 6, back_rank); 
+      movePiece(7, back_rank, 5, back_rank);
     }
 
-    tmp_board.movePiece(move, color);
-   
-    // Set en passant flags
-    // Zero out left 4, then set.
-    tmp_board.special_move_flags_ = tmp_board.special_move_flags_ & 0x0F;
-    tmp_board.special_move_flags_ = tmp_board.special_move_flags_ | (move.en_passant_flags << 4);
-  }
-
-  if(just_castled) {
-    if(cap_value != nullptr) *cap_value = 0;
     // no more castling
-    tmp_board.special_move_flags_ = tmp_board.special_move_flags_ & ~(0b11 << castle_mask_shift);
+    special_move_flags_ = special_move_flags_ & ~(0b11 << castle_mask_shift);
 
     // next guy can't en passant after a castle
-    tmp_board.special_move_flags_ = tmp_board.special_move_flags_ & 0x0F;
+    special_move_flags_ = special_move_flags_ & 0x0F;
+    return;
   }
 
-  if(tmp_board.inCheck(color, cache)) {
-    return false;
+  // If we're about to move a king, no more castling.
+  if(getPieceType(getPieceAt(move.start_file, move.start_rank)) == PieceType::KING) {
+    special_move_flags_ = special_move_flags_ & ~(0b11 << castle_mask_shift);
   }
 
-  if(result == nullptr) {
-    *this = tmp_board;
+  // If we're about to move the H rook, no more king-side castles.
+  // No need to check if it's a rook since moving any piece there means we disabled at some point.
+  if(move.start_file == 7 && move.start_rank == back_rank){
+    special_move_flags_ = special_move_flags_ & ~(0b10 << castle_mask_shift); 
+  } else if (move.start_file == 0 && move.start_rank == back_rank) { // same for queen
+    special_move_flags_ = special_move_flags_ & ~(0b1 << castle_mask_shift); 
+  }
+
+  movePiece(move, color);
+ 
+  // Set en passant flags
+  // Zero out left 4, then set.
+  special_move_flags_ = special_move_flags_ & 0x0F;
+  special_move_flags_ = special_move_flags_ | (move.en_passant_flags << 4);
+}
+
+
+bool Board::givesCheck(const Move& move, Color color) const {
+  const Piece king = buildPiece(PieceType::KING, static_cast<Color>(!color));
+  int king_file = -1, king_rank = -1;
+  for(uint8_t f = 0; f < kBoardDim && king_file < 0; ++f) {
+    for(uint8_t r = 0; r < kBoardDim; ++r) {
+      if(getPieceAt(f, r) == king) {
+        king_file = f;
+        king_rank = r;
+        break;
+      }
+    }
+  }
+  if(king_file < 0) return false;
+
+  // What the move changes: at most two squares emptied and two filled
+  struct Square { int file, rank; PieceType type; };
+  std::array<Square, 2> vacated, placed;
+  int num_vacated = 0, num_placed = 0;
+  const int back_rank = color == Color::WHITE ? 0 : 7;
+  if(move.king_castle || move.queen_castle) {
+    vacated[num_vacated++] = {4, back_rank, PieceType::NONE_TYPE};
+    vacated[num_vacated++] = {move.king_castle ? 7 : 0, back_rank, PieceType::NONE_TYPE};
+    placed[num_placed++] = {move.king_castle ? 6 : 2, back_rank, PieceType::KING};
+    placed[num_placed++] = {move.king_castle ? 5 : 3, back_rank, PieceType::ROOK};
   } else {
-    *result = tmp_board;
+    vacated[num_vacated++] = {move.start_file, move.start_rank, PieceType::NONE_TYPE};
+    if(move.is_en_passant)
+      vacated[num_vacated++] = {move.end_file, move.start_rank, PieceType::NONE_TYPE};
+    PieceType type = move.promotes_to != PieceType::NONE_TYPE
+                     ? move.promotes_to : getPieceType(getPieceAt(move.start_file, move.start_rank));
+    placed[num_placed++] = {move.end_file, move.end_rank, type};
   }
-  return true;
+
+  // The board as it will be after the move
+  auto pieceAt = [&](int file, int rank) {
+    for(int i = 0; i < num_placed; ++i)
+      if(placed[i].file == file && placed[i].rank == rank) return buildPiece(placed[i].type, color);
+    for(int i = 0; i < num_vacated; ++i)
+      if(vacated[i].file == file && vacated[i].rank == rank) return Piece::NONE;
+    return getPieceAt(file, rank);
+  };
+  auto sign = [](int x) { return (x > 0) - (x < 0); };
+
+  // Direct checks by the pieces put down
+  for(int i = 0; i < num_placed; ++i) {
+    const Square& p = placed[i];
+    const int df = king_file - p.file;
+    const int dr = king_rank - p.rank;
+    const bool diagonal = df != 0 && std::abs(df) == std::abs(dr);
+    const bool straight = (df == 0) != (dr == 0);
+
+    bool attacks = false;
+    switch(p.type) {
+      case PieceType::PAWN:
+        attacks = dr == (color == Color::WHITE ? 1 : -1) && std::abs(df) == 1;
+        break;
+      case PieceType::KNIGHT:
+        attacks = std::abs(df * dr) == 2;
+        break;
+      case PieceType::BISHOP:
+      case PieceType::ROOK:
+      case PieceType::QUEEN: {
+        if((p.type == PieceType::ROOK || !diagonal) && (p.type == PieceType::BISHOP || !straight)) break;
+        attacks = true;
+        for(int f = p.file + sign(df), r = p.rank + sign(dr); f != king_file || r != king_rank;
+            f += sign(df), r += sign(dr)) {
+          if(pieceAt(f, r) != Piece::NONE) {
+            attacks = false;
+            break;
+          }
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    if(attacks) return true;
+  }
+
+  // Discovered checks: the first piece out from the king past an emptied square
+  for(int i = 0; i < num_vacated; ++i) {
+    const int df = vacated[i].file - king_file;
+    const int dr = vacated[i].rank - king_rank;
+    const bool diagonal = df != 0 && std::abs(df) == std::abs(dr);
+    const bool straight = (df == 0) != (dr == 0);
+    if(!diagonal && !straight) continue;
+
+    for(int f = king_file + sign(df), r = king_rank + sign(dr);
+        f >= 0 && f < kBoardDim && r >= 0 && r < kBoardDim; f += sign(df), r += sign(dr)) {
+      Piece piece = pieceAt(f, r);
+      if(piece == Piece::NONE) continue;
+      PieceType type = getPieceType(piece);
+      if(getPieceColor(piece) == color
+         && (type == PieceType::QUEEN || type == (diagonal ? PieceType::BISHOP : PieceType::ROOK)))
+        return true;
+      break;
+    }
+  }
+  return false;
 }
 
+int Board::staticExchange(const Move& move, Color color) const {
+  if(!isCapture(move)) return 0;
+
+  // Play the exchange out on a scratch board. Taking pieces off it uncovers
+  // sliders lined up behind them, so x-rays come for free from posAttacked.
+  Board tmp_board = *this;
+  // Only the first capture could be en passant, and stale flags would make
+  // posAttacked report pawns that can't reach the square.
+  tmp_board.special_move_flags_ &= 0x0F;
+
+  const uint8_t file = move.end_file;
+  const uint8_t rank = move.end_rank;
+
+  std::array<int, 32> gain;
+  int depth = 0;
+
+  PieceType victim = move.is_en_passant ? PieceType::PAWN : getPieceType(getPieceAt(file, rank));
+  gain[0] = kExchangeVals[victim];
+
+  tmp_board.movePiece(move, color);
+  int on_square = kExchangeVals[getPieceType(tmp_board.getPieceAt(file, rank))];
+
+  Color side = static_cast<Color>(!color);
+  std::vector<std::pair<uint8_t, uint8_t>> attackers;
+
+  while(depth + 1 < static_cast<int>(gain.size())) {
+    // Pieces of side attacking the square, i.e. enemies of the other color
+    attackers.clear();
+    tmp_board.posAttacked(file, rank, static_cast<Color>(!side), PieceType::NONE_TYPE, &attackers);
+    if(attackers.empty()) break;
+
+    auto least = std::min_element(attackers.begin(), attackers.end(),
+        [&](const auto& a, const auto& b) {
+          return kExchangeVals[getPieceType(tmp_board.getPieceAt(a.first, a.second))]
+               < kExchangeVals[getPieceType(tmp_board.getPieceAt(b.first, b.second))];
+        });
+    PieceType attacker = getPieceType(tmp_board.getPieceAt(least->first, least->second));
+
+    // The king can only take last
+    if(attacker == PieceType::KING) {
+      Board king_board = tmp_board;
+      king_board.movePiece(least->first, least->second, file, rank);
+      if(king_board.posAttacked(file, rank, side)) break;
+    }
+
+    ++depth;
+    gain[depth] = on_square - gain[depth - 1];
+
+    tmp_board.movePiece(least->first, least->second, file, rank);
+    on_square = kExchangeVals[attacker];
+    side = static_cast<Color>(!side);
+  }
+
+  // Each side only recaptures if it's better than stopping
+  while(depth > 0) {
+    gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+    --depth;
+  }
+  return gain[0];
+}
 
 std::string Board::moveToAlgebraicNotation(const Move move) const {
   
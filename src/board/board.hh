@@ -4,6 +4,7 @@
 #include <array>
 #include <cmath>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <vector>
 #include <fmt/format.h>
@@ -43,6 +44,11 @@ constexpr uint8_t kCanEnPassantMask     = 0b10000000;
 
 namespace chess {
 
+constexpr char kStartingFen[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Room writeFen needs, including the terminating null
+constexpr size_t kMaxFenLength = 96;
+
 enum PieceType : uint8_t {
   NONE_TYPE = 0,
   PAWN      = 0b001,
@@ -54,6 +60,9 @@ enum PieceType : uint8_t {
 };
 
 constexpr std::array<uint8_t, 6> kPieceVals = {0, 1, 5, 3, 3, 9};
+// Same, but indexable by every PieceType. Kings can't be traded, so they count as
+// worth more than anything they could take.
+constexpr std::array<int, 7> kExchangeVals = {0, 1, 5, 3, 3, 9, 100};
 
 const std::unordered_map<char, PieceType> kTypeFromChar{
   {'R',PieceType::ROOK},
@@ -89,6 +98,14 @@ static std::vector kAllPieces{NONE, WHITE_PAWN, WHITE_ROOK,
   WHITE_BISHOP, WHITE_KNIGHT, WHITE_QUEEN, WHITE_KING, BLACK_PAWN, 
   BLACK_ROOK, BLACK_BISHOP, BLACK_KNIGHT, BLACK_QUEEN, BLACK_KING};
 
+// A move squeezed into 16 bits:
+// <flags [0..3]> <end square [0..5]> <start square [0..5]>
+// Squares are file*8 + rank, same as the board layout.
+// Flags: 0 = plain, 1 = pawn double move, 2 = king castle, 3 = queen castle,
+//        4 = en passant, 8 | (promotes_to - 2) = promotion (rook, bishop, knight, queen)
+using PackedMove = uint16_t;
+constexpr PackedMove kNullPackedMove = 0;
+
 
 struct Move {
   uint8_t start_rank;
@@ -126,6 +143,25 @@ struct Move {
   }
 
   std::string str() const;
+
+  // As UCI writes it: start and end square, plus the promotion piece ("e7e8q").
+  // color is the side making the move, needed for castles.
+  std::string uci(Color color) const;
+
+  bool operator==(const Move& other) const {
+    return start_file == other.start_file && start_rank == other.start_rank
+        && end_file == other.end_file && end_rank == other.end_rank
+        && promotes_to == other.promotes_to
+        && king_castle == other.king_castle && queen_castle == other.queen_castle
+        && is_null == other.is_null;
+  }
+
+  bool operator!=(const Move& other) const {
+    return !(*this == other);
+  }
+
+  PackedMove pack() const;
+  static Move unpack(PackedMove packed);
 };
 
 
@@ -157,6 +193,24 @@ public:
   void setBoard(const std::string& board_string);
   void setBoardFromFile(const std::string& fname);
 
+  // FEN: placement, side to move (returned in player), castling rights and en
+  // passant square, then optionally the two move clocks, which aren't kept.
+  // Doesn't allocate. Returns false, leaving everything alone, if fen isn't valid.
+  bool setFen(std::string_view fen, Color* player);
+
+  // EPD: the first four FEN fields followed by operations ("bm Nf3; id \"x\";"),
+  // which are returned as a view into epd
+  bool setEpd(std::string_view epd, Color* player, std::string_view* operations = nullptr);
+
+  // Null terminated FEN (clocks written as "0 1"), or with epd set just its first
+  // four fields. out must have room for kMaxFenLength. Returns the length.
+  size_t writeFen(Color player, char* out, bool epd = false) const;
+  std::string fen(Color player) const;
+
+  // Exactly one king of each color. Board files don't have to have them, but
+  // inCheck and the move generator assume it.
+  bool hasBothKings() const;
+
   void writeToFile(const std::string& fname = "board.txt");
  
   // Naive: Doesn't check legality or capture. Just overwrites end pos with start piece.
@@ -167,6 +221,11 @@ public:
   
   bool isColor(uint8_t file, uint8_t rank, const Color color) const;
   bool isOtherColor(uint8_t file, uint8_t rank, const Color color) const;
+
+  bool isCapture(const Move& m) const {
+    if(m.king_castle || m.queen_castle) return false;
+    return m.is_en_passant || !isEmpty(m.end_file, m.end_rank);
+  }
   
   bool operator==(const Board& other) const {
     return data_ == other.data_ && special_move_flags_ == other.special_move_flags_;
@@ -199,6 +258,20 @@ public:
   bool doMove(Move move, Color color, CachePtr cache, Board* result = nullptr, int* cap_value = nullptr);
   bool doMove(Move move, Color color, Board* result = nullptr, int* cap_value = nullptr);
 
+  // Plays the move in place without checking whether it leaves color in check.
+  // For replaying moves already known to be legal.
+  void makeMove(const Move& move, Color color);
+
+  // Static exchange evaluation: material color expects to net (in kPieceVals units)
+  // if both sides keep recapturing on the move's target square, always with their
+  // least valuable attacker, and either side may stop when it stops paying off.
+  int staticExchange(const Move& move, Color color) const;
+
+  // Whether color's legal move puts the other king in check, without playing it:
+  // an attack test from each piece the move puts down, and a look along the
+  // king's lines through each square it empties for a discovered check.
+  bool givesCheck(const Move& move, Color color) const;
+
   std::string moveToAlgebraicNotation(const Move m) const;
   Move moveFromAlgebraicNotation(const std::string s, Color color) const;
 
@@ -227,6 +300,19 @@ private:
   CachePtr cache_{nullptr};
 };
 
+// Hash used to key positions in search tables. The side to move flips bits all
+// over the key: flipping just the low bit would collide with the castling
+// flags, which the board hash adds in last.
+inline uint64_t positionKey(const Board& board, Color player) {
+  return board.computeHash() ^ (player == Color::BLACK ? 0x9E3779B97F4A7C15ull : 0);
+}
+
+// Slot for key in a power-of-two table of mask + 1 slots. Board hashes are
+// weak in the low bits, so the key is mixed first and the high half used.
+inline size_t slotIndex(uint64_t key, uint64_t mask) {
+  return (key * 0x9E3779B97F4A7C15ull >> 32) & mask;
+}
+
 }; // namespace chess
 
 namespace std {
@@ -21,6 +21,9 @@ enum State {
 struct Evaluation {
   State state;
   float value;
+  // The game is actually over (mate, stalemate or bare kings). Otherwise a
+  // state other than NORMAL is only a guess from the material left.
+  bool game_over{false};
 
   std::string str() {
     std::string state_str;
@@ -57,8 +60,8 @@ class Evaluator {
   
   Evaluation operator()(Color color){
 
-    bool white_has_dark_bishop, white_has_light_bishop;
-    bool black_has_dark_bishop, black_has_light_bishop;
+    bool white_has_dark_bishop{false}, white_has_light_bishop{false};
+    bool black_has_dark_bishop{false}, black_has_light_bishop{false};
 
     // bit 0 = none, bit 1 = pawn, and so on (follows enum)
     uint8_t white_has = 0;
@@ -93,12 +96,13 @@ class Evaluator {
         if(pt == PieceType::KING) continue;
 
         value += kPieceVals.at(getPieceType(p))
-                  * board_.isColor(file, rank, color) ? 1 : -1;
+                  * (board_.isColor(file, rank, color) ? 1 : -1);
       
       }
     }
     Evaluation result;
     result.value = value;
+    result.game_over = true;
 
     const uint8_t king_only = 0b1 << PieceType::KING;
       
@@ -120,6 +124,7 @@ class Evaluator {
       result.state = State::STALEMATE;
     }
     else if (white_has == king_only) {
+      result.game_over = false;
       if((black_has_light_bishop && black_has_dark_bishop)
           || (black_has & 1 << PieceType::ROOK)
           || (black_has & 1 << PieceType::QUEEN)
@@ -134,6 +139,7 @@ class Evaluator {
       }
     }
     else if (black_has == king_only) {
+      result.game_over = false;
       if((white_has_light_bishop && white_has_dark_bishop)
           || (white_has & 1 << PieceType::ROOK)
           || (white_has & 1 << PieceType::QUEEN)
@@ -151,11 +157,27 @@ class Evaluator {
     }
     else {
       result.state = State::NORMAL;
+      result.game_over = false;
     }
 
     return result;
   }
 
+  // Just the material balance from color's point of view, without the (expensive)
+  // game over checks. Fine for positions the caller already knows are still going.
+  float material(Color color) const {
+    float value = 0;
+    for(int file = 0; file < 8; ++file){
+      for(int rank = 0; rank < 8; ++rank){
+        Piece p = board_.getPieceAt(file, rank);
+        PieceType pt = getPieceType(p);
+        if(pt == PieceType::NONE_TYPE || pt == PieceType::KING) continue;
+        value += kPieceVals[pt] * (getPieceColor(p) == color ? 1 : -1);
+      }
+    }
+    return value;
+  }
+
  private:
   // If this player is IN checkmate (NOT applying)
   bool isCheckmate(Color color) {
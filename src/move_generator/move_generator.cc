@@ -28,7 +28,11 @@ const Directions kQueenDirs{{0,1}, {0,-1}, {1,0}, {-1,0},
 MoveGenerator::MoveGenerator(const Board& b) : board_(b)
 {}
 
-MoveList MoveGenerator::getMovesForPiece(uint8_t file, uint8_t rank) const
+static bool wants(GenType gen, GenType kind) {
+  return gen == GenType::ALL_MOVES || gen == kind;
+}
+
+MoveList MoveGenerator::getMovesForPiece(uint8_t file, uint8_t rank, GenType gen) const
 {
   auto piece = board_.getPieceAt(file, rank);
   const PieceType type = getPieceType(piece);
@@ -38,22 +42,22 @@ MoveList MoveGenerator::getMovesForPiece(uint8_t file, uint8_t rank) const
 
   switch(type) {
     case PieceType::PAWN:
-      moves = getMovesForPawn(file, rank, color);
+      moves = getMovesForPawn(file, rank, color, gen);
       break;
     case PieceType::ROOK:
-      moves = getMovesForDirs(file, rank, kRookDirs, color);
+      moves = getMovesForDirs(file, rank, kRookDirs, color, false, gen);
       break;
     case PieceType::BISHOP:
-      moves = getMovesForDirs(file, rank, kBishopDirs, color);
+      moves = getMovesForDirs(file, rank, kBishopDirs, color, false, gen);
       break;
     case PieceType::KNIGHT:
-      moves = getMovesForDirs(file, rank, kKnightDirs, color, true);
+      moves = getMovesForDirs(file, rank, kKnightDirs, color, true, gen);
       break;
     case PieceType::QUEEN:
-      moves = getMovesForDirs(file, rank, kQueenDirs, color);
+      moves = getMovesForDirs(file, rank, kQueenDirs, color, false, gen);
       break;
     case PieceType::KING:
-      moves = getMovesForDirs(file, rank, kQueenDirs, color, true);
+      moves = getMovesForDirs(file, rank, kQueenDirs, color, true, gen);
       break;
     defult:
       throw std::runtime_error(fmt::format("Invalid piece {0:x}", piece));
@@ -73,16 +77,62 @@ MoveList MoveGenerator::getMovesForPlayer(Color color, CachePtr cache) const {
     return result;
   }
 
+  getPseudoLegalMoves(color, GenType::ALL_MOVES, &result);
+
+  auto to_return = filterLegalMoves(result, color, cache);
+  if(cache) {
+    cache->insert(board_, color, to_return);
+  }
+  return to_return;
+}
+
+MoveList MoveGenerator::getWeightedMovesForPlayer(Color color, std::vector<float>* weights,
+                                                 CachePtr cache) const {
+  MoveList result = getMovesForPlayer(color, cache);
+  weights->clear();
+  weights->reserve(result.size());
+
+  for(const auto& m : result) {
+    float weight = 1;
+    if(board_.isCapture(m)) {
+      PieceType victim = m.is_en_passant ? PieceType::PAWN
+                                         : getPieceType(board_.getPieceAt(m.end_file, m.end_rank));
+      weight += 2 * kExchangeVals[victim];
+    }
+    weight += 2 * kExchangeVals[m.promotes_to];
+    if(board_.givesCheck(m, color)) weight += 3;
+
+    weights->push_back(weight);
+  }
+  return result;
+}
+
+void MoveGenerator::getPseudoLegalMoves(Color color, GenType gen, MoveList* result) const {
   for(int file = 0; file < kBoardDim; ++file) {
     for(int rank = 0; rank < kBoardDim; ++rank) {
       if(!board_.isColor(file, rank, color)) continue;
-      auto moves = getMovesForPiece(file, rank);
-      result.insert(result.end(),
-                    std::make_move_iterator(moves.begin()),
-                    std::make_move_iterator(moves.end()));
+      auto moves = getMovesForPiece(file, rank, gen);
+      result->insert(result->end(),
+                     std::make_move_iterator(moves.begin()),
+                     std::make_move_iterator(moves.end()));
     }
   }
 
+  if(wants(gen, GenType::QUIETS)) addCastles(color, result);
+}
+
+bool MoveGenerator::isPseudoLegal(const Move& m, Color color) const {
+  MoveList candidates;
+  if(m.king_castle || m.queen_castle) {
+    addCastles(color, &candidates);
+  } else {
+    if(!board_.isColor(m.start_file, m.start_rank, color)) return false;
+    candidates = getMovesForPiece(m.start_file, m.start_rank);
+  }
+  return std::find(candidates.begin(), candidates.end(), m) != candidates.end();
+}
+
+void MoveGenerator::addCastles(Color color, MoveList* result) const {
   // Castling (only works for 8x8 board).
   // To simplify downstream stuff, make sure that this castle is legit (none of the
   // pieces the king goes through are under attack).
@@ -94,43 +144,40 @@ MoveList MoveGenerator::getMovesForPlayer(Color color, CachePtr cache) const {
         && board_.getPieceAt(0,0) == Piece::WHITE_ROOK
         && board_.getPieceAt(4,0) == Piece::WHITE_KING) {
 
-      result.emplace_back(0,0,0,0);
-      result.at(result.size() - 1).queen_castle = 1;
-    } else if ((board_.special_move_flags_ & kWhiteKingCastleMask)
+      result->emplace_back(0,0,0,0);
+      result->back().queen_castle = 1;
+    }
+    // King
+    if ((board_.special_move_flags_ & kWhiteKingCastleMask)
         && board_.isEmpty(5,0) && board_.isEmpty(6,0)
         && !(board_.posAttacked(4,0,color) || board_.posAttacked(5,0,color) || board_.posAttacked(6,0,color))
         && board_.getPieceAt(7,0) == Piece::WHITE_ROOK
         && board_.getPieceAt(4,0) == Piece::WHITE_KING) {
       
-      result.emplace_back(0,0,0,0);
-      result.at(result.size() - 1).king_castle = 1;
+      result->emplace_back(0,0,0,0);
+      result->back().king_castle = 1;
     }
   } else {
     if ((board_.special_move_flags_ & kBlackQueenCastleMask)
         && board_.isEmpty(1,7) && board_.isEmpty(2,7) && board_.isEmpty(3,7)
-        && !(board_.posAttacked(2,0,color) || board_.posAttacked(3,0,color) || board_.posAttacked(4,0,color))
+        && !(board_.posAttacked(2,7,color) || board_.posAttacked(3,7,color) || board_.posAttacked(4,7,color))
         && board_.getPieceAt(0,7) == Piece::BLACK_ROOK
         && board_.getPieceAt(4,7) == Piece::BLACK_KING) {
     
-      result.emplace_back(0,0,0,0);
-      result.at(result.size() - 1).queen_castle = 1;
-    } else if ((board_.special_move_flags_ & kBlackKingCastleMask)
+      result->emplace_back(0,0,0,0);
+      result->back().queen_castle = 1;
+    }
+    if ((board_.special_move_flags_ & kBlackKingCastleMask)
         && board_.isEmpty(5,7) && board_.isEmpty(6,7)
         && !(board_.posAttacked(4,7,color) || board_.posAttacked(5,7,color) || board_.posAttacked(6,7,color))
         && board_.getPieceAt(7,7) == Piece::BLACK_ROOK
         && board_.getPieceAt(4,7) == Piece::BLACK_KING) {
       
-      result.emplace_back(0,0,0,0);
-      result.at(result.size() - 1).king_castle = 1;
+      result->emplace_back(0,0,0,0);
+      result->back().king_castle = 1;
     }
     
   }
-  
-  auto to_return = filterLegalMoves(result, color, cache);
-  if(cache) {
-    cache->insert(board_, color, to_return);
-  }
-  return to_return;
 }
 
 MoveList MoveGenerator::filterLegalMoves(MoveList& in_list, Color color, CachePtr cache) const {
@@ -144,7 +191,7 @@ MoveList MoveGenerator::filterLegalMoves(MoveList& in_list, Color color, CachePt
   return in_list;
 }
 
-MoveList MoveGenerator::getMovesForPawn(uint8_t file, uint8_t rank, Color color) const {
+MoveList MoveGenerator::getMovesForPawn(uint8_t file, uint8_t rank, Color color, GenType gen) const {
   int8_t dir, double_rank, promote_rank, ep_rank;
 
   if(color == Color::WHITE) {
@@ -160,25 +207,29 @@ MoveList MoveGenerator::getMovesForPawn(uint8_t file, uint8_t rank, Color color)
   }
   
   MoveList result;
+  const bool promotes = rank + dir == promote_rank;
+
   // If we can move forward
   if(board_.isEmpty(file, rank + dir)) {
     // Double move. Ignore the stupid edge case where board is 4 long and it can promote.
     // Also in general assume that promoting a pawn doesn't go off end of board.
-    if(rank == double_rank && board_.isEmpty(file, rank + 2*dir)) {
+    if(rank == double_rank && board_.isEmpty(file, rank + 2*dir) && wants(gen, GenType::QUIETS)) {
       Move new_move(file, rank, file, rank+2*dir);
       new_move.en_passant_flags = 0b1000 | file;
       result.push_back(new_move);
     }
-    if (rank + dir == promote_rank) {
+    if (promotes && wants(gen, GenType::PROMOTIONS)) {
       result.emplace_back(file, rank, file, rank + dir, PieceType::QUEEN);
       result.emplace_back(file, rank, file, rank + dir, PieceType::ROOK);
       result.emplace_back(file, rank, file, rank + dir, PieceType::KNIGHT);
       result.emplace_back(file, rank, file, rank + dir, PieceType::BISHOP);
-    } else {
+    } else if (!promotes && wants(gen, GenType::QUIETS)) {
       result.emplace_back(file, rank, file, rank+dir);
     }
   }
 
+  if(!wants(gen, GenType::CAPTURES)) return result;
+
   // Capture diagonal: ++file
   if(file + 1 < kBoardDim && board_.isOtherColor(file + 1, rank + dir, color)) {
     if(rank + dir == promote_rank) {
@@ -224,9 +275,10 @@ MoveList MoveGenerator::getMovesForPawn(uint8_t file, uint8_t rank, Color color)
 
 MoveList MoveGenerator::getMovesForDirs(uint8_t file,
                                         uint8_t rank,
-                                        Directions dirs,
+                                        const Directions& dirs,
                                         Color color,
-                                        bool one_step) const {
+                                        bool one_step,
+                                        GenType gen) const {
   MoveList result; 
 
   for(const auto& d : dirs) {
@@ -243,10 +295,12 @@ MoveList MoveGenerator::getMovesForDirs(uint8_t file,
       if(board_.isColor(new_file, new_rank, color)) break;
 
       // Otherwise, we can go at least this many steps
-      result.emplace_back(file, rank, new_file, new_rank);
+      bool captures = board_.isOtherColor(new_file, new_rank, color);
+      if(wants(gen, captures ? GenType::CAPTURES : GenType::QUIETS))
+        result.emplace_back(file, rank, new_file, new_rank);
       
       // If we run into any piece, all done
-      if (one_step || board_.isOtherColor(new_file, new_rank, color)) break;
+      if (one_step || captures) break;
       ++steps;
     }
   }
@@ -14,6 +14,13 @@ namespace chess {
 // file inc, rank inc
 using Directions = std::vector<std::pair<int8_t, int8_t>>;
 
+// Which slice of the moves to generate. Promotions that capture count as captures.
+enum GenType {
+  ALL_MOVES,
+  CAPTURES,    // including en passant
+  PROMOTIONS,  // non-capturing ones
+  QUIETS       // everything else, including castling
+};
 
 class MoveGenerator {
 
@@ -21,18 +28,32 @@ class MoveGenerator {
   MoveGenerator() = delete;
   MoveGenerator(const Board& b);
   
-  MoveList getMovesForPiece(uint8_t file, uint8_t rank) const;
+  MoveList getMovesForPiece(uint8_t file, uint8_t rank, GenType gen = GenType::ALL_MOVES) const;
   MoveList getMovesForPlayer(Color color) const;
   MoveList getMovesForPlayer(Color color, CachePtr cache) const;
 
+  // Legal moves (through the cache) plus a playout weight for each: 1, plus
+  // bonuses for captures (by victim), promotions and checks. Checks are found
+  // with Board::givesCheck, so no move is played out to weigh it.
+  MoveList getWeightedMovesForPlayer(Color color, std::vector<float>* weights, CachePtr cache = nullptr) const;
+
+  // Pseudo-legal: may leave the king in check, which doMove() will refuse.
+  // Castling is only generated when it's fully legal.
+  void getPseudoLegalMoves(Color color, GenType gen, MoveList* result) const;
+
+  // Could m have been generated for this position? Used to vet moves from hash tables.
+  bool isPseudoLegal(const Move& m, Color color) const;
+
   void setCache(CachePtr cache) {
     cache_ = cache;
   }
 
  private:
   
-  MoveList getMovesForPawn(uint8_t file, uint8_t rank, Color color) const;
-  MoveList getMovesForDirs(uint8_t file, uint8_t rank, Directions dirs, Color color, bool one_step = false) const;
+  MoveList getMovesForPawn(uint8_t file, uint8_t rank, Color color, GenType gen = GenType::ALL_MOVES) const;
+  MoveList getMovesForDirs(uint8_t file, uint8_t rank, const Directions& dirs, Color color,
+                           bool one_step = false, GenType gen = GenType::ALL_MOVES) const;
+  void addCastles(Color color, MoveList* result) const;
 
   MoveList filterLegalMoves(MoveList& in_list, Color color, CachePtr cache) const;
   const Board& board_;
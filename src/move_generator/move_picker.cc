@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <numeric>
+
+#include "move_generator/move_picker.hh"
+
+namespace chess {
+
+MovePicker::MovePicker(const Board& board, Color color, PackedMove hash_move, bool tactical_only) :
+  board_(board),
+  move_gen_(board),
+  color_(color),
+  hash_move_(hash_move),
+  tactical_only_(tactical_only)
+{}
+
+bool MovePicker::next(Move* move) {
+  while(stage_ != PickStage::PICK_DONE) {
+    if(stage_ == PickStage::PICK_HASH_MOVE) {
+      if(!hash_tried_ && hash_move_ != kNullPackedMove) {
+        hash_tried_ = true;
+        // The table can hand us a move from a colliding position
+        Move m = Move::unpack(hash_move_);
+        if(move_gen_.isPseudoLegal(m, color_)) {
+          *move = m;
+          return true;
+        }
+      }
+      stage_ = PickStage::PICK_GOOD_CAPTURES;
+      continue;
+    }
+
+    if(!stage_ready_) {
+      generateStage();
+      stage_ready_ = true;
+    }
+
+    while(cursor_ < moves_.size()) {
+      const Move& m = moves_[cursor_++];
+      if(hash_move_ != kNullPackedMove && m.pack() == hash_move_) continue;
+
+      // Only look at the exchange once the capture is about to be tried
+      if(stage_ == PickStage::PICK_GOOD_CAPTURES && board_.staticExchange(m, color_) < 0) {
+        bad_captures_.push_back(m);
+        continue;
+      }
+
+      *move = m;
+      return true;
+    }
+
+    // Move to the next stage
+    stage_ready_ = false;
+    cursor_ = 0;
+    switch(stage_) {
+      case PickStage::PICK_GOOD_CAPTURES:
+        stage_ = PickStage::PICK_PROMOTIONS;
+        break;
+      case PickStage::PICK_PROMOTIONS:
+        stage_ = tactical_only_ ? PickStage::PICK_DONE : PickStage::PICK_QUIETS;
+        break;
+      case PickStage::PICK_QUIETS:
+        stage_ = PickStage::PICK_BAD_CAPTURES;
+        break;
+      default:
+        stage_ = PickStage::PICK_DONE;
+        break;
+    }
+  }
+  return false;
+}
+
+void MovePicker::generateStage() {
+  moves_.clear();
+  scores_.clear();
+
+  switch(stage_) {
+    case PickStage::PICK_GOOD_CAPTURES:
+      move_gen_.getPseudoLegalMoves(color_, GenType::CAPTURES, &moves_);
+      // MVV-LVA
+      for(const auto& m : moves_) {
+        PieceType victim = m.is_en_passant ? PieceType::PAWN
+                                           : getPieceType(board_.getPieceAt(m.end_file, m.end_rank));
+        PieceType attacker = getPieceType(board_.getPieceAt(m.start_file, m.start_rank));
+        scores_.push_back(kExchangeVals[victim] * 64 - kExchangeVals[attacker]
+                          + kExchangeVals[m.promotes_to]);
+      }
+      break;
+    case PickStage::PICK_PROMOTIONS:
+      move_gen_.getPseudoLegalMoves(color_, GenType::PROMOTIONS, &moves_);
+      for(const auto& m : moves_) scores_.push_back(kExchangeVals[m.promotes_to]);
+      break;
+    case PickStage::PICK_QUIETS:
+      move_gen_.getPseudoLegalMoves(color_, GenType::QUIETS, &moves_);
+      for(const auto& m : moves_) {
+        PackedMove packed = m.pack();
+        if(packed == killers_[0]) scores_.push_back(std::numeric_limits<int>::max());
+        else if(packed == killers_[1]) scores_.push_back(std::numeric_limits<int>::max() - 1);
+        else scores_.push_back(history_ ? history_[historyIndex(m, color_)] : 0);
+      }
+      break;
+    case PickStage::PICK_BAD_CAPTURES:
+      // Already in MVV-LVA order
+      moves_.swap(bad_captures_);
+      return;
+    default:
+      return;
+  }
+
+  std::vector<size_t> order(moves_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return scores_[a] > scores_[b]; });
+
+  MoveList sorted;
+  sorted.reserve(moves_.size());
+  for(size_t i : order) sorted.push_back(moves_[i]);
+  moves_.swap(sorted);
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "board/board.hh"
+#include "move_generator/move_generator.hh"
+
+namespace chess {
+
+// Order the stages are served in. Each one is only generated once the one before it
+// runs dry, so a search that cuts off on the hash move or a good capture never pays
+// for the quiet moves.
+enum PickStage : uint8_t {
+  PICK_HASH_MOVE,
+  PICK_GOOD_CAPTURES,  // SEE >= 0, most valuable victim first
+  PICK_PROMOTIONS,     // non-capturing
+  PICK_QUIETS,         // killers first, then by history
+  PICK_BAD_CAPTURES,   // SEE < 0
+  PICK_DONE
+};
+
+// Index into a [color][start square][end square] history table
+inline size_t historyIndex(const Move& m, Color player) {
+  return (player * 64 + m.start_file * kBoardDim + m.start_rank) * 64
+         + m.end_file * kBoardDim + m.end_rank;
+}
+
+// Hands out the moves of one position a stage at a time, best first.
+// Moves are pseudo-legal: doMove() returning false is how the caller finds the
+// ones that leave the king in check.
+class MovePicker {
+
+ public:
+  // If tactical_only, stop after the promotions (for quiescence search)
+  MovePicker(const Board& board, Color color, PackedMove hash_move = kNullPackedMove,
+             bool tactical_only = false);
+
+  bool next(Move* move);
+
+  // Stage the last move handed out came from
+  PickStage stage() const { return stage_; }
+
+  void setKillers(PackedMove first, PackedMove second) {
+    killers_[0] = first;
+    killers_[1] = second;
+  }
+
+  // Indexed with historyIndex(), must outlive the picker
+  void setHistory(const int* history) { history_ = history; }
+
+ private:
+  // Generate the moves for stage_ into moves_, sorted best first
+  void generateStage();
+
+  const Board& board_;
+  const MoveGenerator move_gen_;
+  const Color color_;
+  const PackedMove hash_move_;
+  const bool tactical_only_;
+
+  PickStage stage_{PickStage::PICK_HASH_MOVE};
+  bool hash_tried_{false};
+  bool stage_ready_{false};
+
+  MoveList moves_;
+  std::vector<int> scores_;
+  size_t cursor_{0};
+
+  // Losing captures found along the way, saved for the end
+  MoveList bad_captures_;
+
+  PackedMove killers_[2]{kNullPackedMove, kNullPackedMove};
+  const int* history_{nullptr};
+};
+
+}
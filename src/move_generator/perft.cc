@@ -0,0 +1,152 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+#include <boost/program_options.hpp>
+
+#include "board/board.hh"
+#include "move_generator/move_generator.hh"
+
+namespace chess {
+
+// Subtree counts by position and depth, shared by all the threads. Same
+// lockless scheme as the TranspositionTable: each slot is the packed entry and
+// the key XOR'd with it, so a slot torn by two writers just reads as a miss.
+class PerftTable {
+ public:
+  PerftTable(size_t size_mb) {
+    size_t slots = 1;
+    while(slots * 2 * sizeof(Slot) <= size_mb * 1024 * 1024) slots *= 2;
+    slots_ = std::make_unique<Slot[]>(slots);
+    mask_ = slots - 1;
+  }
+
+  bool probe(uint64_t key, int depth, uint64_t* count) const {
+    const Slot& slot = slots_[slotIndex(key, mask_)];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if((check ^ data) != key || (data & 0x3F) != static_cast<uint64_t>(depth)) return false;
+    *count = data >> 6;
+    return true;
+  }
+
+  void store(uint64_t key, int depth, uint64_t count) {
+    Slot& slot = slots_[slotIndex(key, mask_)];
+    uint64_t data = (count << 6) | depth;
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> check{0};
+    std::atomic<uint64_t> data{0};
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  uint64_t mask_;
+};
+
+// Leaf positions depth plies below board. The last ply is counted from the
+// size of the move list without playing the moves out.
+static uint64_t perft(const Board& board, Color player, int depth, PerftTable* table) {
+  if(depth == 0) return 1;
+
+  MoveGenerator move_gen(board);
+  MoveList moves = move_gen.getMovesForPlayer(player);
+  if(depth == 1) return moves.size();
+
+  const uint64_t key = positionKey(board, player);
+  uint64_t count = 0;
+  if(table != nullptr && table->probe(key, depth, &count)) return count;
+
+  const Color other = static_cast<Color>(!player);
+  for(const Move& m : moves) {
+    Board child = board;
+    child.makeMove(m, player);
+    count += perft(child, other, depth - 1, table);
+  }
+
+  if(table != nullptr) table->store(key, depth, count);
+  return count;
+}
+
+}
+
+namespace po = boost::program_options;
+
+int main(int argc, char** argv) {
+  std::string fname;
+  std::string fen;
+  bool is_black{false};
+  int depth = 4;
+  int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t hash_mb = 64;
+  bool divide{false};
+
+  po::options_description desc{"Options"};
+  desc.add_options()
+    ("board-file,b", po::value<std::string>(&fname), "File with board desc")
+    ("fen", po::value<std::string>(&fen), "Position as FEN, instead of a board file (default: start position)")
+    ("start-black", po::bool_switch(&is_black), "With a board file, black is to move")
+    ("depth", po::value<int>(&depth), "Plies to count to")
+    ("threads", po::value<int>(&num_threads), "Worker threads, each taking root moves in turn")
+    ("hash", po::value<size_t>(&hash_mb), "Subtree count table size in MB (0 = off)")
+    ("divide", po::bool_switch(&divide), "Print the count under each root move");
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  chess::Board board;
+  chess::Color player = is_black ? chess::Color::BLACK : chess::Color::WHITE;
+  if(!fname.empty()) {
+    board.setBoardFromFile(fname);
+  } else if(!board.setFen(fen.empty() ? chess::kStartingFen : fen, &player)) {
+    std::cerr << "Invalid FEN: " << fen << std::endl;
+    return 1;
+  }
+  // The count table stores depth in 6 bits
+  if(depth < 1 || depth > 63) {
+    std::cerr << "Depth must be from 1 to 63" << std::endl;
+    return 1;
+  }
+
+  std::unique_ptr<chess::PerftTable> table;
+  if(hash_mb > 0) table = std::make_unique<chess::PerftTable>(hash_mb);
+
+  auto start = std::chrono::steady_clock::now();
+
+  chess::MoveGenerator move_gen(board);
+  chess::MoveList root_moves = move_gen.getMovesForPlayer(player);
+  std::vector<uint64_t> counts(root_moves.size(), 0);
+  const chess::Color other = static_cast<chess::Color>(!player);
+
+  std::atomic<size_t> next_move{0};
+  auto worker = [&]() {
+    for(size_t i = next_move++; i < root_moves.size(); i = next_move++) {
+      chess::Board child = board;
+      child.makeMove(root_moves[i], player);
+      counts[i] = chess::perft(child, other, depth - 1, table.get());
+    }
+  };
+  std::vector<std::thread> threads;
+  for(int t = 1; t < num_threads; ++t) threads.emplace_back(worker);
+  worker();
+  for(auto& t : threads) t.join();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t total = 0;
+  for(size_t i = 0; i < root_moves.size(); ++i) {
+    if(divide) fmt::print("{}: {}\n", root_moves[i].uci(player), counts[i]);
+    total += counts[i];
+  }
+  if(divide) fmt::print("\n");
+  fmt::print("Nodes: {}\nTime: {:.0f} ms\nNPS: {:.0f}\n",
+             total, seconds * 1000, total / std::max(seconds, 1e-6));
+  return 0;
+}
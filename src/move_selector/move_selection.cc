@@ -2,74 +2,56 @@
 #include "move_generator/move_generator.hh"
 
 #include <algorithm>
+#include <numeric>
 #include <unordered_map>
 
 namespace chess {
 
-MoveSelection::MoveSelection(const Board& board):
+MoveSelection::MoveSelection(const Board& board, Random* rng):
   move_gen_(board),
-  random_gen_(rd_())
-{
-  std::random_device rd;
-  
-}
+  rng_(rng)
+{}
 
 bool MoveSelection::getMoveForPlayer(Color player, Move* move) {
+  if(policy_ == RolloutPolicy::WEIGHTED_ROLLOUT) {
+    auto moves = move_gen_.getWeightedMovesForPlayer(player, &weights_, cache_);
+    size_t idx;
+    if(!weightedSelectMove(&weights_, &idx)) return false;
+    *move = moves[idx];
+    return true;
+  }
+
   auto moves = move_gen_.getMovesForPlayer(player, cache_);
 
-  std::vector<float> weights;
-  weights.assign(moves.size(), 1);
   size_t idx;
-  bool result = weightedSelectMove(moves, weights, &idx);
-  if(!result) return false;
+  if(!selectMoveIndex(moves.size(), &idx)) return false;
 
   *move = moves[idx];
 
   return true;
 }
 
-bool MoveSelection::getMoveForPlayer(Color player, MoveList moves, size_t* move_idx) {
-  std::vector<float> weights;
-  weights.assign(moves.size(), 1);
-  
-  size_t idx;
-  bool result = weightedSelectMove(moves, weights, &idx);
-  
-  if(!result) return false;
+bool MoveSelection::selectMoveIndex(size_t num_moves, size_t* move_idx) {
+  if(num_moves == 0) return false;
 
-  *move_idx = idx;
+  *move_idx = rng_->below(num_moves);
 
   return true;
 }
 
-// Note that this edits weights but i don't care
-bool MoveSelection::weightedSelectMove(MoveList moves,
-        std::vector<float> weights, 
+bool MoveSelection::weightedSelectMove(std::vector<float>* weights, 
         size_t* index) {
+  if(weights->empty()) return false;
 
-  float sum = 0;
+  // Sampling against the running sums skips normalizing
+  std::partial_sum(weights->begin(), weights->end(), weights->begin());
 
-  // Normalize the vector
-  for(auto w : weights) {
-    sum += w;
-  }
+  float rand_num = rng_->uniform() * weights->back();
 
-  for(auto& w : weights)
-    w /= sum;
-  
-  float rand_num = dist_(random_gen_);
-
-  float run_weight_sum = 0;
-  size_t i = 0;
-  for(auto w : weights) {
-    run_weight_sum += w;
-    if(run_weight_sum > rand_num) {
-      *index = i;
-      return true;
-    }
-    ++i;
-  }
-  return false;
+  auto it = std::upper_bound(weights->begin(), weights->end(), rand_num);
+  // Guard against rand_num landing exactly on the total
+  *index = std::min<size_t>(it - weights->begin(), weights->size() - 1);
+  return true;
 }
 
 }
@@ -81,7 +63,8 @@ bool MoveSelection::weightedSelectMove(MoveList moves,
 int main() {
 
   chess::Board b("./board/config/starting_position");
-  chess::MoveSelection move_select(b);
+  chess::Random rng(1);
+  chess::MoveSelection move_select(b, &rng);
 
   chess::Move m;
   std::unordered_map<std::string, int> move_freq;
@@ -2,35 +2,46 @@
 
 #include "move_generator/move_generator.hh"
 #include "board/board.hh"
+#include "move_selector/random.hh"
 #include "search/cache_fwd.hh"
 
-#include <random>
-
 namespace chess {
 
+// How playouts pick their moves
+enum RolloutPolicy {
+  UNIFORM_ROLLOUT,  // every legal move equally likely
+  WEIGHTED_ROLLOUT  // captures, promotions and checks favoured
+};
+
 class MoveSelection {
 
  public:
-  MoveSelection(const Board& board);
+  // rng is borrowed, not owned: whoever runs the search keeps one per thread
+  MoveSelection(const Board& board, Random* rng);
 
   bool getMoveForPlayer(Color player, Move* move);
-  bool getMoveForPlayer(Color player, MoveList moves, size_t* move_idx);
+  // Pick one of num_moves candidates the caller keeps track of
+  bool selectMoveIndex(size_t num_moves, size_t* move_idx);
 
   void setCache(CachePtr cache) {
     cache_ = cache;
   }
 
+  void setPolicy(RolloutPolicy policy) { policy_ = policy; }
+
  protected:
 
-  bool weightedSelectMove(MoveList moves, std::vector<float> weights, size_t* move); 
+  // Turns weights into running sums in place, then samples one of them
+  bool weightedSelectMove(std::vector<float>* weights, size_t* index); 
 
-  const MoveGenerator& move_gen_;
+  const MoveGenerator move_gen_;
   
   CachePtr cache_{nullptr};
 
-  // random nonsense
-  std::random_device rd_;
-  std::mt19937 random_gen_;
-  std::uniform_real_distribution<float> dist_;
+  RolloutPolicy policy_{RolloutPolicy::UNIFORM_ROLLOUT};
+  // Kept around so playouts don't allocate per move
+  std::vector<float> weights_;
+
+  Random* rng_;
 };
 }
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace chess {
+
+// xoshiro256** (Blackman & Vigna). 32 bytes of state and a handful of
+// instructions per draw, so each search thread can own one and seed it for
+// reproducible runs. Also usable with the <random> distributions.
+class Random {
+ public:
+  using result_type = uint64_t;
+
+  explicit Random(uint64_t seed = 0) { seed_(seed); }
+
+  void seed(uint64_t seed) { seed_(seed); }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  result_type operator()() {
+    const uint64_t result = rotl(s_[1] * 5, 7) * 9;
+    const uint64_t t = s_[1] << 17;
+
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = rotl(s_[3], 45);
+
+    return result;
+  }
+
+  // Uniform in [0, n). Multiply-shift instead of modulo; the bias is
+  // at most n / 2^32, nothing for move counts.
+  uint32_t below(uint32_t n) {
+    return static_cast<uint32_t>(((*this)() >> 32) * n >> 32);
+  }
+
+  // Uniform in [0, 1)
+  float uniform() {
+    return ((*this)() >> 40) * (1.0f / (1 << 24));
+  }
+
+ private:
+  static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  // Expand the seed with splitmix64 so that small seeds still give a well-mixed state
+  void seed_(uint64_t seed) {
+    for(auto& s : s_) {
+      seed += 0x9E3779B97F4A7C15ull;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      s = z ^ (z >> 31);
+    }
+  }
+
+  uint64_t s_[4];
+};
+
+}
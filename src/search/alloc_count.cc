@@ -0,0 +1,75 @@
+#include <cstdlib>
+#include <new>
+
+#include "search/alloc_count.hh"
+
+// Replacements for the global allocation functions that count into a plain
+// thread_local, so counting costs one TLS increment and no locking. Every form
+// is replaced, nothrow included: memory from an allocator that isn't ours
+// would otherwise end up in our delete (a mismatch under ASan).
+
+namespace {
+
+thread_local chess::AllocCounts counts;
+
+void* allocate(std::size_t size) {
+  ++counts.allocations;
+  counts.bytes += size;
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t align) {
+  ++counts.allocations;
+  counts.bytes += size;
+  const std::size_t alignment = static_cast<std::size_t>(align);
+  // aligned_alloc wants a whole number of alignments
+  return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void* orThrow(void* p) {
+  if(p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void deallocate(void* p) {
+  if(p == nullptr) return;
+  ++counts.frees;
+  std::free(p);
+}
+
+}
+
+void* operator new(std::size_t size) { return orThrow(allocate(size)); }
+void* operator new[](std::size_t size) { return orThrow(allocate(size)); }
+void* operator new(std::size_t size, std::align_val_t align) { return orThrow(allocateAligned(size, align)); }
+void* operator new[](std::size_t size, std::align_val_t align) { return orThrow(allocateAligned(size, align)); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+  return allocateAligned(size, align);
+}
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+  return allocateAligned(size, align);
+}
+
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+
+namespace chess {
+
+AllocCounts threadAllocCounts() {
+  return counts;
+}
+
+}
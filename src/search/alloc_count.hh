@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace chess {
+
+// Heap traffic of the calling thread since it started. Counted by the global
+// operator new and delete in alloc_count.cc, so only meaningful in binaries
+// that link it.
+struct AllocCounts {
+  uint64_t allocations{0};
+  uint64_t frees{0};
+  uint64_t bytes{0};  // total requested, not live
+};
+
+AllocCounts threadAllocCounts();
+
+}
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "search/alpha_beta.hh"
+#include "evaluator/evaluate.hh"
+#include "move_generator/move_generator.hh"
+#include "move_generator/move_picker.hh"
+
+namespace chess {
+
+// Mate scores are stored relative to the node so they stay valid wherever the
+// position is found again.
+static int scoreToTT(int score, int ply) {
+  if(score >= kMateBound) return score + ply;
+  if(score <= -kMateBound) return score - ply;
+  return score;
+}
+
+static int scoreFromTT(int score, int ply) {
+  if(score >= kMateBound) return score - ply;
+  if(score <= -kMateBound) return score + ply;
+  return score;
+}
+
+static bool hasNonPawnMaterial(const Board& board, Color color) {
+  for(uint8_t file = 0; file < kBoardDim; ++file) {
+    for(uint8_t rank = 0; rank < kBoardDim; ++rank) {
+      Piece p = board.getPieceAt(file, rank);
+      if(p == Piece::NONE || getPieceColor(p) != color) continue;
+      PieceType pt = getPieceType(p);
+      if(pt != PieceType::PAWN && pt != PieceType::KING) return true;
+    }
+  }
+  return false;
+}
+
+AlphaBeta::AlphaBeta(int time_limit_ms, int max_depth) :
+  time_limit_ms_(time_limit_ms),
+  max_depth_(std::min(max_depth, kMaxPly - 1))
+{}
+
+Move AlphaBeta::search(const Board& board, const Color player) {
+  start_time_ = std::chrono::steady_clock::now();
+  nodes_ = 0;
+  quiescence_.resetNodes();
+  stop_ = false;
+  for(auto& k : killers_) k.fill(kNullPackedMove);
+  history_.assign(2 * 64 * 64, 0);
+  if(!tt_) tt_ = std::make_shared<TranspositionTable>();
+
+  Move best_move;
+  best_move.is_null = true;
+
+  MoveGenerator move_gen(board);
+  MoveList root_moves = move_gen.getMovesForPlayer(player);
+  if(root_moves.empty()) return best_move;
+  best_move = root_moves[0];
+
+  for(int depth = 1 + depth_offset_; depth <= max_depth_; ++depth) {
+    int score = pvs(board, player, depth, 0, -kInfScore, kInfScore, false);
+
+    // Half-finished iterations can't be trusted
+    if(stop_) break;
+
+    best_move = root_best_;
+
+    auto elapsed = std::chrono::steady_clock::now() - start_time_;
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    if(verbose_)
+        fmt::print("depth {:2d} score {:7d} nodes {:10d} time {:7.0f} ms nps {:9.0f} pv {}\n",
+                 depth, score, nodes_, seconds * 1000, nodes_ / std::max(seconds, 1e-6),
+                 pvString(board, player, depth));
+
+    // No point looking deeper once a forced mate is on the board
+    if(std::abs(score) >= kMateBound) break;
+    if(timeUp()) break;
+  }
+
+  return best_move;
+}
+
+int AlphaBeta::pvs(const Board& board, Color player, int depth, int ply,
+                   int alpha, int beta, bool allow_null) {
+  ++nodes_;
+  if((nodes_ & 1023) == 0 && timeUp()) stop_ = true;
+  if(stop_) return 0;
+
+  const bool pv_node = beta - alpha > 1;
+  const bool in_check = board.inCheck(player);
+  const Color other = static_cast<Color>(!player);
+
+  // Don't stop the search in the middle of a check
+  if(in_check) ++depth;
+
+  if(ply >= kMaxPly - 1) return evaluate(board, player);
+  // Settle the captures before trusting the static score
+  if(depth <= 0) return quiescence_.search(board, player, alpha, beta, ply);
+
+  const uint64_t key = positionKey(board, player);
+  PackedMove hash_move = kNullPackedMove;
+  TTEntry entry;
+  if(tt_->probe(key, &entry)) {
+    hash_move = entry.move;
+    if(!pv_node && ply > 0 && entry.depth >= depth) {
+      int score = scoreFromTT(entry.score, ply);
+      if(entry.bound == BoundType::EXACT_BOUND
+         || (entry.bound == BoundType::LOWER_BOUND && score >= beta)
+         || (entry.bound == BoundType::UPPER_BOUND && score <= alpha))
+        return score;
+    }
+  }
+
+  // Null move: if passing still beats beta, a real move surely will.
+  // Skipped in check and in pawn endings where zugzwang is common.
+  if(allow_null && !pv_node && !in_check && depth >= 3 && ply > 0
+     && hasNonPawnMaterial(board, player) && evaluate(board, player) >= beta) {
+    Board null_board = board;
+    // Passing forfeits en passant
+    null_board.special_move_flags_ &= 0x0F;
+    int reduction = depth > 6 ? 3 : 2;
+    int score = -pvs(null_board, other, depth - 1 - reduction, ply + 1, -beta, -beta + 1, false);
+    if(stop_) return 0;
+    if(score >= beta) return score >= kMateBound ? beta : score;
+  }
+
+  MovePicker picker(board, player, hash_move);
+  picker.setKillers(killers_[ply][0], killers_[ply][1]);
+  picker.setHistory(history_.data());
+
+  const int original_alpha = alpha;
+  int best_score = -kInfScore;
+  Move best_move;
+  int legal_moves = 0;
+  Move m;
+
+  while(picker.next(&m)) {
+    Board child = board;
+    if(!child.doMove(m, player)) continue;
+    ++legal_moves;
+
+    int score;
+    if(legal_moves == 1) {
+      score = -pvs(child, other, depth - 1, ply + 1, -beta, -alpha, true);
+    } else {
+      // Prove it's no better than what we have with a null window, re-search if wrong
+      score = -pvs(child, other, depth - 1, ply + 1, -alpha - 1, -alpha, true);
+      if(score > alpha && score < beta)
+        score = -pvs(child, other, depth - 1, ply + 1, -beta, -alpha, true);
+    }
+    if(stop_) return 0;
+
+    if(score > best_score) {
+      best_score = score;
+      best_move = m;
+      if(ply == 0) root_best_ = m;
+    }
+    if(score > alpha) alpha = score;
+    if(alpha >= beta) {
+      if(!board.isCapture(m) && m.promotes_to == PieceType::NONE_TYPE)
+        updateQuietCutoff(m, player, depth, ply);
+      break;
+    }
+  }
+
+  if(legal_moves == 0) return in_check ? -kMateScore + ply : 0;
+
+  BoundType bound = best_score >= beta ? BoundType::LOWER_BOUND
+                  : best_score > original_alpha ? BoundType::EXACT_BOUND
+                  : BoundType::UPPER_BOUND;
+  tt_->store(key, depth, scoreToTT(best_score, ply), bound, best_move.pack());
+
+  return best_score;
+}
+
+int AlphaBeta::evaluate(const Board& board, Color player) const {
+  Evaluator eval(board);
+  return static_cast<int>(eval.material(player) * 100);
+}
+
+void AlphaBeta::updateQuietCutoff(const Move& m, Color player, int depth, int ply) {
+  PackedMove packed = m.pack();
+  if(killers_[ply][0] != packed) {
+    killers_[ply][1] = killers_[ply][0];
+    killers_[ply][0] = packed;
+  }
+
+  int& h = history_[historyIndex(m, player)];
+  h += depth * depth;
+  // Keep history below the killer scores
+  if(h >= (1 << 22)) {
+    for(auto& v : history_) v /= 2;
+  }
+}
+
+bool AlphaBeta::timeUp() {
+  if(abort_ != nullptr && abort_->load(std::memory_order_relaxed)) return true;
+  auto elapsed = std::chrono::steady_clock::now() - start_time_;
+  return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() >= time_limit_ms_;
+}
+
+std::string AlphaBeta::pvString(const Board& board, Color player, int max_len) const {
+  std::vector<std::string> pv;
+  Board current = board;
+  Color current_player = player;
+
+  for(int i = 0; i < max_len; ++i) {
+    TTEntry entry;
+    if(!tt_->probe(positionKey(current, current_player), &entry)
+       || entry.move == kNullPackedMove) break;
+
+    // The table could hold a stale move from a colliding position, so check it's legal
+    MoveGenerator move_gen(current);
+    MoveList moves = move_gen.getMovesForPlayer(current_player);
+    auto it = std::find(moves.begin(), moves.end(), Move::unpack(entry.move));
+    if(it == moves.end()) break;
+
+    const Move& m = *it;
+    pv.push_back(current.moveToAlgebraicNotation(m));
+    current.doMove(m, current_player);
+    current_player = static_cast<Color>(!current_player);
+  }
+  return fmt::format("{}", fmt::join(pv, " "));
+}
+
+}
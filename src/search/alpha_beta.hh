@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "board/board.hh"
+#include "search/quiescence.hh"
+#include "search/score.hh"
+#include "search/transposition_table.hh"
+
+namespace chess {
+
+// Iterative deepening principal variation search.
+// Depth-first alternative to MCTS for tactical positions, sharing the same
+// Board, MoveGenerator and Evaluator.
+class AlphaBeta {
+
+ public:
+  AlphaBeta(int time_limit_ms, int max_depth = kMaxPly - 1);
+
+  Move search(const Board& board, const Color player);
+
+  size_t nodes() const { return nodes_ + quiescence_.nodes(); }
+
+  // Threads searching together share one table
+  void setTranspositionTable(TTPtr tt) { tt_ = tt; }
+
+  // Polled alongside the clock; setting it makes search() return promptly
+  void setAbortFlag(const std::atomic<bool>* abort) { abort_ = abort; }
+
+  // Iterations start this many plies deeper (used to stagger helper threads)
+  void setDepthOffset(int offset) { depth_offset_ = offset; }
+
+  // If false, don't print a line per finished depth
+  void setVerbose(bool verbose) { verbose_ = verbose; }
+
+ private:
+
+  int pvs(const Board& board, Color player, int depth, int ply, int alpha, int beta, bool allow_null);
+
+  // Static score from player's point of view, in centipawns
+  int evaluate(const Board& board, Color player) const;
+
+  Quiescence quiescence_;
+
+  void updateQuietCutoff(const Move& m, Color player, int depth, int ply);
+
+  bool timeUp();
+
+  std::string pvString(const Board& board, Color player, int max_len) const;
+
+  int time_limit_ms_;
+  int max_depth_;
+
+  TTPtr tt_;
+  const std::atomic<bool>* abort_{nullptr};
+  int depth_offset_{0};
+  bool verbose_{true};
+
+  std::array<std::array<PackedMove, 2>, kMaxPly> killers_;
+  // [color][start square][end square]
+  std::vector<int> history_;
+
+  std::chrono::steady_clock::time_point start_time_;
+  size_t nodes_{0};
+  bool stop_{false};
+
+  Move root_best_;
+};
+
+}
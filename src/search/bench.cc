@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+#include "search/bench.hh"
+
+namespace chess {
+
+// Perft suite positions, for the castling, en passant and promotion cases the
+// board files don't cover
+static const char* kBenchFens[] = {
+  kStartingFen,
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+  "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+  "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+struct BenchPosition {
+  std::string name;
+  Board board;
+  Color player;
+};
+
+// FNV-1a step
+static uint64_t mix(uint64_t hash, uint64_t value) {
+  return (hash ^ value) * 0x100000001B3ull;
+}
+
+int runBench(MCTS* mcts, size_t iterations, uint64_t seed, const std::string& config_dir) {
+  std::vector<BenchPosition> positions;
+
+  std::vector<std::string> fnames;
+  for(const auto& entry : std::filesystem::directory_iterator(config_dir))
+    if(entry.is_regular_file()) fnames.push_back(entry.path().string());
+  std::sort(fnames.begin(), fnames.end());
+  for(const auto& fname : fnames) {
+    Board board(fname);
+    if(board.hasBothKings())
+      positions.push_back({std::filesystem::path(fname).filename().string(), board, Color::WHITE});
+  }
+
+  for(const char* fen : kBenchFens) {
+    BenchPosition position{fen, Board(), Color::WHITE};
+    position.board.setFen(fen, &position.player);
+    positions.push_back(position);
+  }
+
+  mcts->setTimeLimit(-1);
+  mcts->setIterationLimit(iterations);
+  mcts->setVerbose(false);
+  mcts->setCollectStats(true);
+
+  uint64_t total_iterations = 0;
+  uint64_t total_plies = 0;
+  uint64_t total_rollouts = 0;
+  uint64_t total_allocations = 0;
+  uint64_t total_rollout_allocations = 0;
+  uint64_t signature = 0xCBF29CE484222325ull;
+  double total_seconds = 0;
+
+  for(const auto& position : positions) {
+    // Every position starts from scratch, so each one's result stands alone
+    mcts->newGame();
+    mcts->setSeed(seed);
+
+    auto start = std::chrono::steady_clock::now();
+    Move best = mcts->uctSearch(position.board, position.player);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const Tree& tree = mcts->tree();
+    const Node& root = tree[tree.root()];
+    signature = mix(signature, best.is_null ? 0 : best.pack());
+    signature = mix(signature, tree.size());
+    for(NodeId c = root.first_child; c < root.first_child + root.num_expanded; ++c)
+      signature = mix(signature, tree.visits(c));
+
+    const SearchStats& stats = mcts->stats();
+    total_iterations += mcts->iterations();
+    total_plies += stats.rollout_plies;
+    total_rollouts += stats.rollouts;
+    total_allocations += stats.allocations;
+    total_rollout_allocations += stats.rollout_allocations;
+    total_seconds += seconds;
+    fmt::print("{:<64.64} {:>6} {:>8} it {:>10} plies {:>8.0f} ms {:>7.2f} alloc/it\n", position.name,
+               best.is_null ? "-" : best.uci(position.player), mcts->iterations(), stats.rollout_plies,
+               seconds * 1000, double(stats.allocations) / std::max<size_t>(mcts->iterations(), 1));
+  }
+
+  fmt::print("\nPositions: {}\nIterations: {}\nRollout plies: {}\nTime: {:.0f} ms\n"
+             "Nodes/s: {:.0f}\nAllocations/iteration: {:.2f}\nAllocations/rollout: {:.2f}\n"
+             "Signature: {:016x}\n",
+             positions.size(), total_iterations, total_plies, total_seconds * 1000,
+             total_iterations / std::max(total_seconds, 1e-6),
+             double(total_allocations) / std::max<uint64_t>(total_iterations, 1),
+             double(total_rollout_allocations) / std::max<uint64_t>(total_rollouts, 1), signature);
+  return 0;
+}
+
+}
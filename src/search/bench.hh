@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "search/search.hh"
+
+namespace chess {
+
+// End-to-end MCTS throughput: searches every usable board file in config_dir
+// and a few standard test positions for a fixed number of iterations from a
+// fixed seed, then prints the totals and a signature of the trees built. The
+// signature only changes when search behavior does, so two builds printing the
+// same one did the same work and their nodes/s can be compared.
+// mcts is searched with however it's configured, apart from the limits.
+int runBench(MCTS* mcts, size_t iterations, uint64_t seed, const std::string& config_dir);
+
+}
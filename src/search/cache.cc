@@ -6,6 +6,7 @@ namespace chess {
 void Cache::insert(const Board& b, const Color c, const bool in_check) {
   CachePair key(b,c);
   if(cache_map_.count(key) == 0) {
+    makeRoom();
     CacheEntry entry;
     entry.has_check = true;
     entry.in_check = in_check;
@@ -19,6 +20,7 @@ void Cache::insert(const Board& b, const Color c, const bool in_check) {
 void Cache::insert(const Board& b, const Color c, const MoveList& moves){
   CachePair key(b,c);
   if(cache_map_.count(key) == 0) {
+    makeRoom();
     CacheEntry entry;
     entry.has_moves = true;
     entry.legal_moves = moves;
@@ -31,7 +33,10 @@ void Cache::insert(const Board& b, const Color c, const MoveList& moves){
 
 bool Cache::getCacheEntry(const Board& b, const Color c, CacheEntry* result){
   CachePair key(b,c);
-  if(cache_map_.count(key) == 0) return false;
+  if(cache_map_.count(key) == 0) {
+    cache_misses_++;
+    return false;
+  }
   result = &cache_map_.at(key);
   cache_hits_++;
   return true;
@@ -40,6 +45,7 @@ bool Cache::getCacheEntry(const Board& b, const Color c, CacheEntry* result){
 bool Cache::getMoveList(const Board& b, const Color c, MoveList* result){
   CachePair key(b,c);
   if(cache_map_.count(key) == 0 || !cache_map_[key].has_moves) {
+    cache_misses_++;
     return false;
   }
   *result = cache_map_[key].legal_moves;
@@ -50,6 +56,7 @@ bool Cache::getMoveList(const Board& b, const Color c, MoveList* result){
 bool Cache::getInCheck(const Board& b, const Color c, bool* result) {
   CachePair key(b,c);
   if(cache_map_.count(key) == 0 || !cache_map_[key].has_check) {
+    cache_misses_++;
     return false;
   }
   *result = cache_map_[key].in_check;
@@ -62,20 +69,9 @@ bool Cache::contains(const Board& b, const Color c){
   return cache_map_.count(key) != 0;
 }
 
-void Cache::insert(const Node& n, const MoveList& moves){
-  insert(n.board, n.player, moves);
-}  
-
-bool Cache::getCacheEntry(const Node& n, CacheEntry* result){
-  return getCacheEntry(n.board, n.player, result);
-}  
-
-bool Cache::getMoveList(const Node& n, MoveList* result){
-  return getMoveList(n.board, n.player, result);
-}  
+void Cache::makeRoom() {
+  if(cache_map_.size() >= max_entries_) cache_map_.clear();
+}
 
-bool Cache::contains(const Node& n){
-  return contains(n.board, n.player);
-}  
 
 }
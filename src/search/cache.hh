@@ -4,23 +4,23 @@
 #include <memory>
 
 #include "board/board.hh"
-#include "search/search.hh"
 #include "search/cache_fwd.hh"
 
 namespace chess {
   using CachePair = std::pair<Board, Color>;
 }
 
-// Same hash as for a Node
+// Same combination as positionKey in the search
 namespace std {
 
 template <>
 struct hash<chess::CachePair>
 {
   size_t operator()(const chess::CachePair& key) const {
-    // XOR with 31 bits followed by a 0 or 1
-    // This guarantees that the hash is different for different colors 
-    return std::hash<chess::Board>{}(key.first) ^ key.second;
+    // The side to move flips bits all over the hash, so it can't cancel out
+    // against the castling flags in the low bits
+    return std::hash<chess::Board>{}(key.first)
+           ^ (key.second == chess::Color::BLACK ? 0x9E3779B97F4A7C15ull : 0);
   }
 };
 
@@ -36,9 +36,14 @@ struct CacheEntry {
   bool in_check;
 };
 
+// Positions kept before the cache starts over, about 60 MB. Most entries are
+// rollout positions that never come up again, and anything dropped is just
+// recomputed, so emptying it wholesale beats keeping track of age.
+constexpr size_t kDefaultCacheEntries = 1 << 17;
+
 class Cache {
  public:
-  Cache() = default;
+  explicit Cache(size_t max_entries = kDefaultCacheEntries) : max_entries_(max_entries) {}
 
   void insert(const Board& b, const Color c, const bool in_check); 
   bool getInCheck(const Board& b, const Color c, bool* result);
@@ -48,14 +53,20 @@ class Cache {
   bool getMoveList(const Board& b, const Color c, MoveList* result);
   bool contains(const Board& b, const Color c);
 
-  void insert(const Node& n, const MoveList& moves);
-  bool getCacheEntry(const Node& n, CacheEntry* result);
-  bool getMoveList(const Node& n, MoveList* result);
-  bool contains(const Node& n);
+  // Lookups answered from the cache, and ones that had to be computed
+  size_t hits() const { return cache_hits_; }
+  size_t misses() const { return cache_misses_; }
+
+  size_t size() const { return cache_map_.size(); }
 
  private:
+  // Called before adding a new position
+  void makeRoom();
+
   std::unordered_map<CachePair, CacheEntry> cache_map_;
+  size_t max_entries_;
   size_t cache_hits_{0};
+  size_t cache_misses_{0};
 };
 
 }
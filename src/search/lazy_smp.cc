@@ -0,0 +1,50 @@
+#include <thread>
+
+#include "search/lazy_smp.hh"
+
+namespace chess {
+
+LazySMP::LazySMP(int time_limit_ms, int num_threads, int max_depth, size_t tt_size_mb) :
+  tt_(std::make_shared<TranspositionTable>(tt_size_mb))
+{
+  num_threads = std::max(num_threads, 1);
+  for(int i = 0; i < num_threads; ++i) {
+    workers_.push_back(std::make_unique<AlphaBeta>(time_limit_ms, max_depth));
+    AlphaBeta& worker = *workers_.back();
+    worker.setTranspositionTable(tt_);
+    worker.setAbortFlag(&abort_);
+    if(i > 0) {
+      worker.setVerbose(false);
+      // Half the helpers run one ply ahead of the main thread
+      worker.setDepthOffset(i % 2);
+    }
+  }
+}
+
+Move LazySMP::search(const Board& board, const Color player) {
+  abort_ = false;
+
+  std::vector<std::thread> helpers;
+  for(size_t i = 1; i < workers_.size(); ++i) {
+    AlphaBeta* worker = workers_[i].get();
+    helpers.emplace_back([worker, &board, player]() {
+      worker->search(board, player);
+    });
+  }
+
+  Move result = workers_.front()->search(board, player);
+
+  // Helpers only exist to feed the table, stop them as soon as the main thread is done
+  abort_ = true;
+  for(auto& t : helpers) t.join();
+
+  return result;
+}
+
+size_t LazySMP::nodes() const {
+  size_t total = 0;
+  for(const auto& w : workers_) total += w->nodes();
+  return total;
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "search/alpha_beta.hh"
+#include "search/transposition_table.hh"
+
+namespace chess {
+
+// Lazy SMP: every thread runs its own AlphaBeta on the root position and the only
+// thing they share is the transposition table. Helpers start at staggered depths
+// so they fill the table ahead of the main thread, whose answer is the one returned.
+class LazySMP {
+
+ public:
+  LazySMP(int time_limit_ms, int num_threads, int max_depth = kMaxPly - 1, size_t tt_size_mb = 64);
+
+  Move search(const Board& board, const Color player);
+
+  // Summed over all threads, valid once search() returns
+  size_t nodes() const;
+
+  // Only the main thread prints its iterations
+  void setVerbose(bool verbose) { workers_.front()->setVerbose(verbose); }
+
+ private:
+  std::vector<std::unique_ptr<AlphaBeta>> workers_;
+  TTPtr tt_;
+  std::atomic<bool> abort_{false};
+};
+
+}
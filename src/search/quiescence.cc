@@ -0,0 +1,61 @@
+#include "search/quiescence.hh"
+#include "evaluator/evaluate.hh"
+#include "move_generator/move_picker.hh"
+
+namespace chess {
+
+// Allowance on top of the captured piece before a capture is considered hopeless
+static constexpr int kDeltaMargin = 200;
+
+int Quiescence::search(const Board& board, Color player, int alpha, int beta, int ply) {
+  ++nodes_;
+
+  Evaluator eval(board);
+  const int stand_pat = static_cast<int>(eval.material(player) * 100);
+  if(ply >= kMaxPly - 1) return stand_pat;
+
+  const bool in_check = board.inCheck(player);
+  int best_score = -kInfScore;
+
+  if(!in_check) {
+    if(stand_pat >= beta) return stand_pat;
+    if(stand_pat > alpha) alpha = stand_pat;
+    best_score = stand_pat;
+  }
+
+  // In check every evasion is searched, otherwise only captures that don't lose
+  // material and promotions. Losing captures never come out of a tactical picker.
+  MovePicker picker(board, player, kNullPackedMove, !in_check);
+  const Color other = static_cast<Color>(!player);
+  int legal_moves = 0;
+  Move m;
+
+  while(picker.next(&m)) {
+    if(!in_check) {
+      if(m.promotes_to != PieceType::NONE_TYPE && m.promotes_to != PieceType::QUEEN) continue;
+
+      PieceType victim = m.is_en_passant ? PieceType::PAWN
+                                         : getPieceType(board.getPieceAt(m.end_file, m.end_rank));
+      int gain = kPieceVals[victim] * 100;
+      if(m.promotes_to == PieceType::QUEEN) gain += (kPieceVals[PieceType::QUEEN] - 1) * 100;
+      if(stand_pat + gain + kDeltaMargin <= alpha) continue;
+    }
+
+    Board child = board;
+    if(!child.doMove(m, player)) continue;
+    ++legal_moves;
+
+    int score = -search(child, other, -beta, -alpha, ply + 1);
+    if(score > best_score) best_score = score;
+    if(score > alpha) alpha = score;
+    if(alpha >= beta) break;
+  }
+
+  // Mated. Without the quiet moves there's no telling stalemate apart, so that's
+  // only caught in check.
+  if(in_check && legal_moves == 0) return -kMateScore + ply;
+
+  return best_score;
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+#include "board/board.hh"
+#include "search/score.hh"
+
+namespace chess {
+
+// Capture-only search that plays out the exchanges in progress before the
+// Evaluator's material count is trusted. Usable as the leaf of any depth-limited
+// search, or on its own as a quieter static evaluation (e.g. MCTS leaves).
+//
+// - Stand pat: the side to move may decline every capture, so the static score is
+//   a lower bound (except in check, where every evasion is searched instead).
+// - Delta pruning: skip captures that can't reach alpha even if the piece is free.
+// - SEE pruning: skip captures that lose material once the recaptures are counted.
+class Quiescence {
+
+ public:
+  Quiescence() = default;
+
+  // Score in centipawns from player's point of view
+  int search(const Board& board, Color player,
+             int alpha = -kInfScore, int beta = kInfScore, int ply = 0);
+
+  size_t nodes() const { return nodes_; }
+  void resetNodes() { nodes_ = 0; }
+
+ private:
+  size_t nodes_{0};
+};
+
+}
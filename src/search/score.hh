@@ -0,0 +1,12 @@
+#pragma once
+
+namespace chess {
+
+// Scores used by the depth-first searches, in centipawns from the side to move's view.
+constexpr int kMaxPly = 128;
+constexpr int kMateScore = 1000000;
+// Anything above this is a forced mate, with the distance encoded in the remainder
+constexpr int kMateBound = kMateScore - kMaxPly;
+constexpr int kInfScore = kMateScore + 1;
+
+}
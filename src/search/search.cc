@@ -1,12 +1,25 @@
+#include <algorithm>
+#include <numeric>
 #include <chrono>
 #include <cmath>
 #include <boost/program_options.hpp>
 #include <iostream>
 #include <cassert>
 #include <fstream>
+#include <random>
+#include <stdexcept>
 #include <thread>
 
 #include "search/search.hh"
+#include "search/alloc_count.hh"
+#include "search/alpha_beta.hh"
+#include "search/bench.hh"
+#include "search/lazy_smp.hh"
+#include "search/quiescence.hh"
+#include "search/transposition_table.hh"
+#include "search/tree_snapshot.hh"
+#include "search/uci.hh"
+#include "search/uct_select.hh"
 #include "evaluator/evaluate.hh"
 #include "move_selector/move_selection.hh"
 
@@ -18,64 +31,279 @@ float exploration_constant = 0;
 
 namespace chess {
 
-void Node::generateDotFile(std::string out_fname, int max_depth)
-{
-  int node_idx = 0;
-  std::vector<std::string> contents = generateDotHelper(max_depth, node_idx, -1);
+// All the material on the board at the start, in pawns
+constexpr float kMaxLeafValue = 39;
+
+// Only the end of the game counts as proven. The evaluator's calls on the
+// material left (K+R vs K wins, K+P vs K draws) don't see hanging pieces.
+static ProvenState provenFromEvaluation(const Evaluation& evaluation, Color player) {
+  if(!evaluation.game_over) return ProvenState::UNPROVEN;
+  switch(evaluation.state) {
+    case State::STALEMATE:
+      return ProvenState::PROVEN_DRAW;
+    case State::WHITE_WINS:
+      return player == Color::WHITE ? ProvenState::PROVEN_WIN : ProvenState::PROVEN_LOSS;
+    case State::BLACK_WINS:
+      return player == Color::BLACK ? ProvenState::PROVEN_WIN : ProvenState::PROVEN_LOSS;
+    default:
+      return ProvenState::UNPROVEN;
+  }
+}
+
+Tree::Tree(const Board& board, const Color player) : root_board_(board) {
+  const size_t initial = 1 << 16;
+  nodes_.reserve(initial);
+  visits_.reserve(initial);
+  values_.reserve(initial);
+  proven_.reserve(initial);
+  amaf_visits_.reserve(initial);
+  amaf_values_.reserve(initial);
+
+  nodes_.emplace_back(kNullPackedMove, player);
+  visits_.push_back(0);
+  values_.push_back(0);
+  proven_.push_back(ProvenState::UNPROVEN);
+  amaf_visits_.push_back(0);
+  amaf_values_.push_back(0);
+}
+
+Tree::Tree(const TreeSnapshot& snapshot) : root_board_(snapshot.rootBoard()) {
+  const size_t n = snapshot.size();
+  nodes_.assign(snapshot.nodes(), snapshot.nodes() + n);
+  visits_.assign(snapshot.visits(), snapshot.visits() + n);
+  values_.assign(snapshot.values(), snapshot.values() + n);
+  proven_.assign(snapshot.proven(), snapshot.proven() + n);
+  amaf_visits_.assign(snapshot.amafVisits(), snapshot.amafVisits() + n);
+  amaf_values_.assign(snapshot.amafValues(), snapshot.amafValues() + n);
+}
+
+NodeId Tree::addChildren(NodeId parent, size_t count) {
+  NodeId first = static_cast<NodeId>(nodes_.size());
+  Color child_player = static_cast<Color>(!nodes_[parent].player);
+  size_t new_size = nodes_.size() + count;
+  nodes_.resize(new_size, Node(kNullPackedMove, child_player));
+  visits_.resize(new_size, 0);
+  values_.resize(new_size, 0);
+  proven_.resize(new_size, ProvenState::UNPROVEN);
+  amaf_visits_.resize(new_size, 0);
+  amaf_values_.resize(new_size, 0);
+
+  nodes_[parent].first_child = first;
+  nodes_[parent].num_children = static_cast<uint16_t>(count);
+  return first;
+}
+
+void Tree::syncLinks(NodeId parent) {
+  const Node& n = nodes_[parent];
+  for(NodeId c = n.first_child; c < n.first_child + n.num_expanded; ++c) {
+    NodeId target = nodes_[c].link;
+    if(target == kNullNode) continue;
+    visits_[c] = visits_[target];
+    values_[c] = values_[target];
+    proven_[c] = proven_[target];
+  }
+}
+
+void Tree::reroot(NodeId id, const Board& board) {
+  id = resolve(id);
+  Tree kept(board, nodes_[id].player);
+  kept.nodes_[0].num_expanded = nodes_[id].num_expanded;
+  kept.visits_[0] = visits_[id];
+  kept.values_[0] = values_[id];
+  kept.proven_[0] = proven_[id];
+
+  // Old node -> its copy. Breadth first, so each child block is copied whole.
+  std::unordered_map<NodeId, NodeId> moved{{id, 0}};
+  std::vector<std::pair<NodeId, NodeId>> queue{{id, 0}};
+  for(size_t q = 0; q < queue.size(); ++q) {
+    const NodeId from = queue[q].first;
+    const NodeId to = queue[q].second;
+    const Node& n = nodes_[from];
+    if(!n.movesGenerated()) continue;
+
+    const NodeId block = kept.addChildren(to, n.num_children);
+    for(uint16_t i = 0; i < n.num_children; ++i) {
+      const NodeId slot = n.first_child + i;
+      const NodeId target = resolve(slot);
+      Node& copy = kept.nodes_[block + i];
+      copy.last_move = nodes_[slot].last_move;
+      copy.repetition = nodes_[slot].repetition;
+      kept.amaf_visits_[block + i] = amaf_visits_[slot];
+      kept.amaf_values_[block + i] = amaf_values_[slot];
+      if(i >= n.num_expanded) continue;
+
+      kept.visits_[block + i] = visits_[target];
+      kept.values_[block + i] = values_[target];
+      kept.proven_[block + i] = proven_[target];
+
+      auto it = moved.find(target);
+      if(it != moved.end()) {
+        copy.link = it->second;
+      } else {
+        // The first slot to reach a node owns it from now on, even if it
+        // used to be a link
+        copy.num_expanded = nodes_[target].num_expanded;
+        moved.emplace(target, block + i);
+        queue.emplace_back(target, block + i);
+      }
+    }
+  }
+
+  *this = std::move(kept);
+}
+
+void Tree::rebuildPositions() {
+  positions_.clear();
+  rebuildPositionsHelper(root(), root_board_);
+}
+
+void Tree::rebuildPositionsHelper(NodeId id, const Board& board) {
+  const Node& n = nodes_[id];
+  addPosition(positionKey(board, n.player), board, id);
+
+  for(NodeId c = n.first_child; c < n.first_child + n.num_expanded; ++c) {
+    if(nodes_[c].link != kNullNode || nodes_[c].repetition) continue;
+    Board child_board = board;
+    child_board.makeMove(Move::unpack(nodes_[c].last_move), n.player);
+    rebuildPositionsHelper(c, child_board);
+  }
+}
 
+NodeId Tree::findPosition(uint64_t key, const Board& board) const {
+  auto it = positions_.find(key);
+  if(it == positions_.end() || it->second.first != board) return kNullNode;
+  return it->second.second;
+}
+
+// Cheap guess at how promising a move is, for ordering expansion:
+// captures by MVV-LVA, then promotions, then checks.
+static int movePrior(const Board& board, const Move& m, Color player) {
+  int prior = kExchangeVals[m.promotes_to] * 64;
+  if(board.isCapture(m)) {
+    PieceType victim = m.is_en_passant ? PieceType::PAWN
+                                       : getPieceType(board.getPieceAt(m.end_file, m.end_rank));
+    PieceType attacker = getPieceType(board.getPieceAt(m.start_file, m.start_rank));
+    prior += kExchangeVals[victim] * 64 - kExchangeVals[attacker];
+  }
+
+  Board after = board;
+  after.makeMove(m, player);
+  if(after.inCheck(static_cast<Color>(!player))) prior += 32;
+  return prior;
+}
+
+void Tree::printStats() const {
+  size_t bytes = nodes_.capacity() * sizeof(Node)
+               + visits_.capacity() * sizeof(uint32_t) + values_.capacity() * sizeof(float)
+               + proven_.capacity() * sizeof(ProvenState)
+               + amaf_visits_.capacity() * sizeof(uint32_t) + amaf_values_.capacity() * sizeof(float);
+  fmt::print("Tree Size: {} Nodes ({} allocated, {:.1f} MB)\n", treeSize(), size(),
+             bytes / (1024. * 1024.));
+  fmt::print("Tree Depth: {}\n", treeDepth());
+}
+
+size_t Tree::treeDepth() const {
+  return treeDepthHelper(root()) - 1;
+}
+
+size_t Tree::treeDepthHelper(NodeId id) const {
+  const Node& n = nodes_[id];
+  size_t max_child_depth = 0;
+  for(NodeId c = n.first_child; c < n.first_child + n.num_expanded; ++c) {
+    size_t child_depth = treeDepthHelper(c);
+    if(child_depth > max_child_depth)
+      max_child_depth = child_depth;
+  }
+
+  return 1 + max_child_depth;
+}
+
+size_t Tree::treeSize() const {
+  return treeSizeHelper(root());
+}
+
+size_t Tree::treeSizeHelper(NodeId id) const {
+  const Node& n = nodes_[id];
+  size_t count = 1;
+
+  for(NodeId c = n.first_child; c < n.first_child + n.num_expanded; ++c) {
+    // Shared nodes are counted where they live
+    if(nodes_[c].link == kNullNode)
+      count += treeSizeHelper(c);
+  }
+
+  return count;
+}
+
+void Tree::generateDotFile(const std::string& out_fname, const DotOptions& options) const {
   std::ofstream output_stream(out_fname);
-  output_stream << "digraph search_tree {" << std::endl;
-  for(const auto& s : contents)
-    output_stream << "  " << s << std::endl;
-  output_stream << "}" << std::endl;
-  output_stream.close();
+  writeDot(output_stream, options);
 }
 
-// node_idx is the index of the node currently being expanded.
-// We copy it for our use, then increment once per child created.
-std::vector<std::string> Node::generateDotHelper(int max_depth, int& node_idx, float uct_val) const {
-  if(max_depth == 0) return {}; // covers case where depth is passed as -1
-  
-  if(max_depth > 0) --max_depth; // don't decrement -1, that's just dumb
+void Tree::writeDot(std::ostream& os, const DotOptions& options) const {
+  os << "digraph search_tree {\n";
+  size_t emitted = 0;
+  writeDotNode(os, options, root(), root_board_, 0, -1, &emitted);
+  os << "}\n";
+}
 
-  int this_node_idx = node_idx;
-  
-  std::vector<std::string> local_list;
-  std::string last_move_str = node_idx == 0? "ROOT" : parent->board.moveToAlgebraicNotation(last_move);
-  
-  std::string label = format_verbose ? fmt::format("{} (Count: {}) \n Val: {}, UCT: {}",
-                                        last_move_str, expand_count, value,
-                                        uct_val == -1? "inf" : std::to_string(uct_val))
-                                     : last_move_str;
+// Writes id and, depth first, the children that make the cut. Nodes are
+// numbered in the order they're written, so *emitted is also the next number.
+void Tree::writeDotNode(std::ostream& os, const DotOptions& options, NodeId id,
+                        const Board& parent_board, int depth, float uct_val, size_t* emitted) const {
+  const Node& n = nodes_[id];
+  const NodeId stats = resolve(id);
+  const size_t this_node_idx = (*emitted)++;
+
+  // The root's own board stands in for its missing parent
+  Board board = parent_board;
+  std::string last_move_str = "ROOT";
+  if(id != root()) {
+    Move m = Move::unpack(n.last_move);
+    last_move_str = parent_board.moveToAlgebraicNotation(m);
+    board.makeMove(m, static_cast<Color>(!n.player));
+  }
 
-  std::string node_str = fmt::format("{} [label=\"{}\"]", this_node_idx, label);
-  
-  local_list.push_back(node_str);
- 
-  // Main base case is when node has no children
-  for(const auto& c : children) {
-    float val = c.value / c.expand_count + 
-      exploration_constant * std::sqrt(2 * std::log(expand_count) / c.expand_count);
-    
-    ++node_idx;
+  if(options.verbose) {
+    os << fmt::format("  {} [label=\"{} (Count: {}) \\n Val: {}, UCT: {}\"]\n",
+                      this_node_idx, last_move_str, visits_[stats], values_[stats],
+                      uct_val == -1? "inf" : std::to_string(uct_val));
+  } else {
+    os << fmt::format("  {} [label=\"{}\"]\n", this_node_idx, last_move_str);
+  }
 
-    local_list.push_back(fmt::format("{}->{}", this_node_idx, node_idx));
-    
-    std::vector<std::string> child_list = c.generateDotHelper(max_depth, node_idx, val);
-    
-    local_list.insert(local_list.end(), child_list.begin(), child_list.end());
+  if(options.max_depth >= 0 && depth >= options.max_depth) return;
+
+  // Most visited first, so top_k and max_nodes both keep the interesting part
+  std::vector<NodeId> children;
+  children.reserve(n.num_expanded);
+  for(NodeId c = n.first_child; c < n.first_child + n.num_expanded; ++c) children.push_back(c);
+  std::stable_sort(children.begin(), children.end(), [&](NodeId a, NodeId b) {
+    return visits_[resolve(a)] > visits_[resolve(b)];
+  });
+  if(options.top_k > 0 && children.size() > options.top_k) children.resize(options.top_k);
+
+  for(NodeId c : children) {
+    if(options.max_nodes > 0 && *emitted >= options.max_nodes) return;
+
+    const NodeId child = resolve(c);
+    float val = values_[child] / visits_[child] + 
+      exploration_constant * std::sqrt(2 * std::log(visits_[stats]) / visits_[child]);
+
+    os << fmt::format("  {}->{}\n", this_node_idx, *emitted);
+    writeDotNode(os, options, c, board, depth + 1, val, emitted);
   }
-  return local_list;
 }
 
-void Node::compareHashes() {
+void Tree::compareHashes(size_t max_nodes) const {
   TimeMap sdbm_time;
   TimeMap djb2_time;
 
   size_t sdbm_collisions{0};
   size_t djb2_collisions{0};
 
-  compareHashesHelper(sdbm_time, sdbm_collisions, djb2_time, djb2_collisions);
+  size_t budget = max_nodes;
+  compareHashesHelper(root(), root_board_, budget, sdbm_time, sdbm_collisions, djb2_time, djb2_collisions);
 
   fmt::print("SDBM Collisions: {}, DJB2 Collisions: {}\n",
               sdbm_collisions, djb2_collisions);
@@ -106,10 +334,15 @@ void Node::compareHashes() {
              djb2_min_time, djb2_max_time, djb2_total_time/djb2_time.size());
 }
 
-void Node::compareHashesHelper(TimeMap& sdbm_time, size_t& sdbm_collisions,
-                               TimeMap& djb2_time, size_t& djb2_collisions){
+void Tree::compareHashesHelper(NodeId id, const Board& board, size_t& budget,
+                               TimeMap& sdbm_time, size_t& sdbm_collisions,
+                               TimeMap& djb2_time, size_t& djb2_collisions) const {
+  if(budget == 0) return;
+  --budget;
 
   const size_t num_tries = 1000;
+  const Node& n = nodes_[id];
+  const std::pair<Board, Color> position(board, n.player);
   
   size_t hash;
 
@@ -126,10 +359,10 @@ void Node::compareHashesHelper(TimeMap& sdbm_time, size_t& sdbm_collisions,
   size_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end-start).count()/num_tries;
   
   if(sdbm_time.count(hash) != 0) {
-    if(sdbm_time.at(hash).first != *this)
+    if(sdbm_time.at(hash).first != position)
       ++sdbm_collisions;
   } else {
-    sdbm_time.emplace(hash, std::pair<Node, size_t>(*this, ns));
+    sdbm_time.emplace(hash, std::make_pair(position, ns));
   }
 
   start = std::chrono::steady_clock::now();
@@ -140,193 +373,466 @@ void Node::compareHashesHelper(TimeMap& sdbm_time, size_t& sdbm_collisions,
   
   ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end-start).count()/num_tries;
   if(djb2_time.count(hash) != 0) {
-    if(djb2_time.at(hash).first != *this)
+    if(djb2_time.at(hash).first != position)
       ++djb2_collisions;
   } else {
-    djb2_time.emplace(hash, std::pair<Node, size_t>(*this,ns));
+    djb2_time.emplace(hash, std::make_pair(position, ns));
   }
 
-  for(auto& c : children) {
-    c.compareHashesHelper(sdbm_time, sdbm_collisions, djb2_time, djb2_collisions);
+  for(NodeId c = n.first_child; c < n.first_child + n.num_expanded; ++c) {
+    Board child_board = board;
+    child_board.makeMove(Move::unpack(nodes_[c].last_move), n.player);
+    compareHashesHelper(c, child_board, budget, sdbm_time, sdbm_collisions, djb2_time, djb2_collisions);
   }
 }
 
-MCTS::MCTS(int time_limit_ms) : time_limit_ms_(time_limit_ms)
+MCTS::MCTS(int time_limit_ms) :
+  time_limit_ms_(time_limit_ms),
+  rng_(std::random_device{}())
 {}
 
+MCTS::~MCTS() {
+  stopPondering();
+}
+
+void MCTS::prepareTree(const Board& board, const Color player) {
+  bool resume = resume_tree_ && tree_ && tree_->rootBoard() == board && tree_->rootPlayer() == player;
+  if(resume_tree_ && !resume)
+    std::cerr << "Warning: saved tree is for a different position, starting over" << std::endl;
+  resume_tree_ = false;
+
+  if(!resume) tree_ = std::make_unique<Tree>(board, player);
+  if(transpositions_) tree_->rebuildPositions();
+}
+
 Move MCTS::uctSearch(const Board& board, const Color player) {
   Move root_move;
   root_move.is_null = true;
-  Node root_node(board, player, root_move);
-  
-  Node* current_node = &root_node;
 
-  cache_ = std::make_shared<Cache>();
-  
-  MoveGenerator move_gen(board);
-  move_gen.setCache(cache_);
-  current_node->unexplored_children = move_gen.getMovesForPlayer(player);
- 
+  stopPondering();
+  prepareTree(board, player);
+  Tree& tree = *tree_;
+  const NodeId root = tree.root();
+  const uint32_t reused = tree.visits(root);
+
+  // The cache only depends on the position, so it carries over between
+  // searches. It's bounded, so this doesn't grow over a game.
+  if(!cache_) cache_ = std::make_shared<Cache>();
+#ifndef CHESS_NO_SEARCH_STATS
+  const size_t cache_hits = cache_->hits();
+  const size_t cache_misses = cache_->misses();
+#endif
+
+  stats_ = SearchStats();
+  active_stats_ = collect_stats_ ? &stats_ : nullptr;
+
+#ifndef CHESS_NO_SEARCH_STATS
+  const uint64_t allocations = threadAllocCounts().allocations;
+#endif
   auto start = std::chrono::system_clock::now();
+  iterations_ = runIterations(board, player, time_limit_ms_, iteration_limit_);
   auto end = std::chrono::system_clock::now();
-  while(std::chrono::duration_cast<std::chrono::milliseconds>(end-start).count() 
-        < time_limit_ms_) {
+
+  double seconds = std::chrono::duration<double>(end - start).count();
+
+  SEARCH_STATS_ADD(active_stats_, total_ns,
+                   std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+  SEARCH_STATS_ADD(active_stats_, cache_hits, cache_->hits() - cache_hits);
+  SEARCH_STATS_ADD(active_stats_, cache_misses, cache_->misses() - cache_misses);
+  SEARCH_STATS_ADD(active_stats_, tree_nodes, tree.size());
+  SEARCH_STATS_ADD(active_stats_, allocations, threadAllocCounts().allocations - allocations);
+  active_stats_ = nullptr;
+
+  if(!snapshot_file_.empty() && !saveSnapshot(tree, snapshot_file_))
+    std::cerr << "Warning: couldn't write tree snapshot " << snapshot_file_ << std::endl;
+  if(verbose_) {
+    fmt::print("Iterations: {} in {:.0f} ms ({:.0f} nodes/s)", iterations_, seconds * 1000,
+               iterations_ / std::max(seconds, 1e-6));
+    if(reused > 0) fmt::print(", {} carried over", reused);
+    fmt::print("\n");
+  }
+
+  NodeId best_child = finalChild(root);
+  if(best_child == kNullNode) return root_move;
+  return Move::unpack(tree[best_child].last_move);
+}
+
+size_t MCTS::runIterations(const Board& board, const Color player, int time_limit_ms,
+                           size_t max_iterations) {
+  Tree& tree = *tree_;
+  const NodeId root = tree.root();
+  size_t iterations = 0;
+
+  auto start = std::chrono::system_clock::now();
+  auto end = start;
+  while(!stop_pondering_.load(std::memory_order_relaxed)) {
+    // One iteration expands a root move, so even an aborted or zero time
+    // search has a move to answer with
+    if(iterations > 0) {
+      if(abort_ != nullptr && abort_->load(std::memory_order_relaxed)) break;
+      if(time_limit_ms >= 0
+         && std::chrono::duration_cast<std::chrono::milliseconds>(end-start).count() >= time_limit_ms)
+        break;
+    }
+    if(max_iterations > 0 && iterations >= max_iterations) break;
+
+    // Nothing left to learn once the root's result is known
+    if(tree.proven(root) != ProvenState::UNPROVEN) break;
 
     if(do_debug) {
       fmt::print("Loop: {} of {}\n",
           std::chrono::duration_cast<std::chrono::milliseconds>(end-start).count(),
-          time_limit_ms_);
+          time_limit_ms);
     }
 
-    current_node = treePolicy(&root_node);
+    Board current_board = board;
+    Color current_player = player;
+    bool repetition = false;
+    NodeId current_node = treePolicy(&current_board, &current_player, &repetition);
+    ++iterations;
+    SEARCH_STATS_ADD(active_stats_, iterations, 1);
+    SEARCH_STATS_MAX(active_stats_, max_depth, path_.size() - 1);
 
     // TODO: detect the case where there's actually nothing left to explore
-    if(current_node == nullptr) {
+    if(current_node == kNullNode) {
       end = std::chrono::system_clock::now();
-      if(do_assert) assert(current_node);
+      if(do_assert) assert(current_node != kNullNode);
       continue;
     }
     
-    float value = defaultPolicy(current_node);
-    backPropagate(current_node, value);
+    // Coming back around to a position already on the path is a draw
+    float value = repetition ? 0 : defaultPolicy(current_node, current_board, current_player);
+    backPropagate(value);
     end = std::chrono::system_clock::now();
   }
   if(do_debug)
     std::cerr << "exit" << std::endl;
 
-  root_node.generateDotFile("graph.dot");
-  root_node.printStats();
-  root_node.compareHashes();
+  return iterations;
+}
+
+void MCTS::newGame() {
+  stopPondering();
+  tree_.reset();
+  resume_tree_ = false;
+  cache_.reset();
+}
+
+bool MCTS::advance(const Move& m) {
+  stopPondering();
+  resume_tree_ = false;
+  if(!tree_) return false;
+
+  Tree& tree = *tree_;
+  const Node& root = tree[tree.root()];
+  const PackedMove packed = m.pack();
+  for(NodeId c = root.first_child; c < root.first_child + root.num_expanded; ++c) {
+    if(tree[c].last_move != packed) continue;
+    Board board = tree.rootBoard();
+    board.makeMove(m, root.player);
+    tree.reroot(c, board);
+    resume_tree_ = true;
+    return true;
+  }
+
+  tree_.reset();
+  return false;
+}
 
-  // TODO: if current_node is nullptr, this is a problem
-  Node* best_child = bestChild(&root_node);
-  return best_child->last_move;
+void MCTS::startPondering(const Board& board, const Color player) {
+  stopPondering();
+  prepareTree(board, player);
+  // The next uctSearch picks up where pondering left off
+  resume_tree_ = true;
+  if(!cache_) cache_ = std::make_shared<Cache>();
+
+  stop_pondering_ = false;
+  ponder_iterations_ = 0;
+  ponder_thread_ = std::thread([this, board, player]() {
+    ponder_iterations_ = runIterations(board, player, -1, 0);
+  });
 }
 
-Node* MCTS::treePolicy(Node* n) {
+size_t MCTS::stopPondering() {
+  if(!ponder_thread_.joinable()) return 0;
+  stop_pondering_ = true;
+  ponder_thread_.join();
+  stop_pondering_ = false;
+  return ponder_iterations_;
+}
+
+NodeId MCTS::treePolicy(Board* board, Color* player, bool* repetition) {
   if(do_debug)
     std::cerr << "tree policy" << std::endl;
- 
-  Node* current_node = n;
-  Node* result;
-  while(current_node->children.size() > 0) {
-    if(current_node->unexplored_children.size() > 0) {
-      result = expand(current_node);
-      if(do_assert) assert(result);
-      return result;
+  SEARCH_STATS_TIMER(active_stats_, tree_policy_ns);
+
+  Tree& tree = *tree_;
+  NodeId current_node = tree.root();
+  NodeId result;
+
+  path_.clear();
+  path_.push_back(current_node);
+  played_.clear();
+
+  if(tree.proven(current_node) != ProvenState::UNPROVEN) return kNullNode;
+
+  while(tree[current_node].movesGenerated()) {
+    const Node& n = tree[current_node];
+    NodeId next = n.num_expanded < expansionLimit(current_node) ? kNullNode : bestChild(current_node);
+
+    // Widen early if everything tried so far has been solved
+    if(next == kNullNode && n.num_expanded < n.num_children) {
+      result = expand(current_node, board, player);
+      if(do_assert) assert(result != kNullNode);
+      return enterChild(result, repetition);
+    }
+
+    // Every child is solved, so this node is too. Hand it back so the
+    // result gets propagated to the ancestors.
+    if(next == kNullNode) {
+      updateProven(current_node);
+      return current_node;
     }
-    current_node = bestChild(current_node);
-    if(do_assert) assert(current_node);
+
+    board->makeMove(Move::unpack(tree[next].last_move), *player);
+    *player = static_cast<Color>(!*player);
+    played_.push_back(tree[next].last_move);
+
+    current_node = enterChild(next, repetition);
+    if(*repetition) return current_node;
   }
-  result = expand(current_node);
-  if(do_assert) assert(result);
-  return result;
+
+  // Terminal position: nothing to expand, just re-score it
+  if(tree.proven(current_node) != ProvenState::UNPROVEN) return current_node;
+
+  result = expand(current_node, board, player);
+  if(do_assert) assert(result != kNullNode);
+  return enterChild(result, repetition);
+}
+
+NodeId MCTS::enterChild(NodeId slot, bool* repetition) {
+  // expand hands back the node itself when it's the end of the game
+  if(slot == kNullNode || slot == path_.back()) return slot;
+  Tree& tree = *tree_;
+
+  // Only a graph can lead back to a node that's already on the path. The
+  // ancestor's stats say nothing about the draw, so the slot stops linking
+  // there and keeps its own from now on.
+  const NodeId n = tree.resolve(slot);
+  if(n != slot && std::find(path_.begin(), path_.end(), n) != path_.end()) {
+    tree[slot].link = kNullNode;
+    tree[slot].repetition = true;
+    tree.visits(slot) = 0;
+    tree.value(slot) = 0;
+    tree.proven(slot) = ProvenState::UNPROVEN;
+  }
+
+  *repetition = tree[slot].repetition;
+  path_.push_back(*repetition ? slot : n);
+  return path_.back();
 }
 
-Node* MCTS::expand(Node* n) {
-  Color player = n->player;
+NodeId MCTS::expand(NodeId n, Board* board, Color* player) {
   if(do_debug)
     std::cerr << "expand" << std::endl;
-  MoveSelection selector(n->board);
-  selector.setCache(cache_);
-  
-  if(n->unexplored_children.size() == 0) {
-    std::cerr << "Warning: tried to expand node without unexplored children" << std::endl;
-    std::cerr << n->children.size() << std::endl;
-    std::cerr << n->board << std::endl;
-    return nullptr;
+  SEARCH_STATS_TIMER(active_stats_, expand_ns);
+  Tree& tree = *tree_;
+
+  generateMoves(n, *board, *player);
+
+  // No legal moves: the game is over here (normally caught by defaultPolicy
+  // already, but the root never goes through it)
+  if(tree[n].num_children == 0) {
+    tree.proven(n) = provenFromEvaluation(Evaluator(*board, cache_)(*player), *player);
+    if(tree.proven(n) != ProvenState::UNPROVEN) return n;
   }
 
-  size_t move_idx;
-  if(!selector.getMoveForPlayer(player, n->unexplored_children, &move_idx)) {
-    std::cerr << "Warning: failed to get move for player" << std::endl;
-    return nullptr;
+  Node& node = tree[n];
+  if(node.num_expanded == node.num_children) {
+    std::cerr << "Warning: tried to expand node without unexplored children" << std::endl;
+    std::cerr << node.num_children << std::endl;
+    std::cerr << *board << std::endl;
+    return kNullNode;
   }
-  
-  Move m = n->unexplored_children[move_idx];
-  
-  n->unexplored_children.erase(n->unexplored_children.begin() + move_idx);
-  Board new_board;
-  
-  if(!n->board.doMove(m, player, &new_board)) {
-    std::cerr << "Move was illegal" << std::endl;
-    std::cerr << "Requested Move: " << m.str() << std::endl;
-    
-    std::cerr << "COLOR: " << (player == Color::WHITE? "White" : "Black") << std::endl;
 
-    try {
-      std::cerr << "Requested Move Alg: " << n->board.moveToAlgebraicNotation(m) << std::endl;
-    } catch (...) {
-      std::cerr << "<can't format>" << std::endl;
+  // The block was put in trying order (shuffled, or by prior) when it was
+  // generated, so the next untried move is just the next slot
+  NodeId child = node.first_child + node.num_expanded;
+  ++node.num_expanded;
+
+  board->makeMove(Move::unpack(tree[child].last_move), *player);
+  *player = static_cast<Color>(!*player);
+  played_.push_back(tree[child].last_move);
+
+  if(transpositions_) {
+    uint64_t key = positionKey(*board, *player);
+    NodeId existing = tree.findPosition(key, *board);
+    if(existing != kNullNode) {
+      tree[child].link = existing;
+      return child;
     }
-  
-    std::cout << "Board: " << n->board << std::endl;
-
-    throw std::runtime_error("Failed to do move");
+    tree.addPosition(key, *board, child);
   }
-  
-  n->children.emplace_back(new_board, static_cast<Color>(!player), m);
-  Node& child = n->children.back();
-  child.parent = n;
 
-  // Pre-compute the possible moves
-  MoveGenerator move_gen(new_board);
+  // The child's moves are only generated if it gets expanded itself
+  return child;
+}
+
+void MCTS::generateMoves(NodeId n, const Board& board, const Color player) {
+  if((*tree_)[n].movesGenerated()) return;
+  SEARCH_STATS_ADD(active_stats_, move_generations, 1);
+
+  MoveGenerator move_gen(board);
   move_gen.setCache(cache_);
-  MoveList moves = move_gen.getMovesForPlayer(child.player);
-  assert(moves.size() > 0);
-  child.unexplored_children = std::move(moves);
-  
+  MoveList moves = move_gen.getMovesForPlayer(player);
+
+  if(widening_c_ > 0) {
+    std::vector<int> priors;
+    priors.reserve(moves.size());
+    for(const auto& m : moves) priors.push_back(movePrior(board, m, player));
+
+    std::vector<size_t> order(moves.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return priors[a] > priors[b]; });
+
+    MoveList sorted;
+    sorted.reserve(moves.size());
+    for(size_t i : order) sorted.push_back(moves[i]);
+    moves.swap(sorted);
+  } else {
+    // Fisher-Yates, so expand can hand out moves in order
+    for(size_t i = moves.size(); i > 1; --i)
+      std::swap(moves[i - 1], moves[rng_.below(i)]);
+  }
 
-  Node* result = &(n->children.back());
-  if(do_assert) assert(result);
-  return result;
+  NodeId first = tree_->addChildren(n, moves.size());
+  for(size_t i = 0; i < moves.size(); ++i)
+    (*tree_)[first + i].last_move = moves[i].pack();
+}
+
+size_t MCTS::expansionLimit(NodeId id) const {
+  const Node& n = (*tree_)[id];
+  if(widening_c_ <= 0) return n.num_children;
+  size_t limit = static_cast<size_t>(widening_c_ * std::pow(tree_->visits(id), widening_exponent_));
+  return std::min<size_t>(std::max<size_t>(limit, 1), n.num_children);
 }
 
-Node* MCTS::bestChild(Node* n) {
+NodeId MCTS::bestChild(NodeId n) {
   if(do_debug)
     std::cerr << "best child" << std::endl; 
-  size_t idx = 0;
-  float max_val = -1*std::numeric_limits<float>::infinity();
-  size_t max_idx = 0;
-  for(auto& c : n->children) {
-    // std::cerr << "child board: " << std::endl << c.board << std::endl;
-    float val = c.value / c.expand_count + 
-     exploration_constant * std::sqrt(2 * std::log(n->expand_count) / c.expand_count);
-    if (val > max_val) {
-      max_val = val;
-      max_idx = idx;
-    }
-    ++idx;
+  Tree& tree = *tree_;
+  const Node& parent = tree[n];
+  if(parent.num_expanded == 0) return kNullNode;
+
+  if(transpositions_) tree.syncLinks(n);
+
+  const NodeId first = parent.first_child;
+  UCTBlock block;
+  block.value = &tree.value(first);
+  block.visits = &tree.visits(first);
+  block.proven = reinterpret_cast<const uint8_t*>(&tree.proven(first));
+  block.amaf_value = &tree.amafValue(first);
+  block.amaf_visits = &tree.amafVisits(first);
+  block.size = parent.num_expanded;
+
+  // Only the parent's share of the exploration term needs a log
+  float explore = exploration_constant * std::sqrt(2 * std::log(static_cast<float>(tree.visits(n))));
+  size_t idx = uctArgmax(block, explore, rave_equivalence_);
+
+  if(idx == block.size) return kNullNode;
+  if(do_assert) assert(first + idx != n);
+  return first + idx;
+}
+
+NodeId MCTS::finalChild(NodeId n) {
+  const Tree& tree = *tree_;
+  const Node& parent = tree[n];
+
+  NodeId draw = kNullNode;
+  for(NodeId c = parent.first_child; c < parent.first_child + parent.num_expanded; ++c) {
+    // The opponent is lost after this move
+    ProvenState proven = tree.proven(tree.resolve(c));
+    if(proven == ProvenState::PROVEN_LOSS) return c;
+    if(proven == ProvenState::PROVEN_DRAW) draw = c;
   }
 
-  Node* max_node = &(n->children[max_idx]);
+  NodeId best = bestChild(n);
+  if(best != kNullNode) return best;
+  if(draw != kNullNode) return draw;
+  if(parent.num_expanded == 0) return kNullNode;
+  return parent.first_child;
+}
 
-  if(do_assert) {
-    assert(max_node != n);
-    assert(max_node != nullptr);
+bool MCTS::updateProven(NodeId n) {
+  Tree& tree = *tree_;
+  const Node& node = tree[n];
+  if(tree.proven(n) != ProvenState::UNPROVEN) return false;
+
+  // A single losing reply for the opponent is enough.
+  bool all_proven = true;
+  bool all_won = true;
+  for(NodeId c = node.first_child; c < node.first_child + node.num_expanded; ++c) {
+    ProvenState proven = tree.proven(tree.resolve(c));
+    if(proven == ProvenState::PROVEN_LOSS) {
+      tree.proven(n) = ProvenState::PROVEN_WIN;
+      return true;
+    }
+    all_proven = all_proven && proven != ProvenState::UNPROVEN;
+    all_won = all_won && proven == ProvenState::PROVEN_WIN;
   }
-  return max_node;
 
+  // Everything else needs every move tried.
+  if(!all_proven || node.num_children == 0 || node.num_expanded < node.num_children) return false;
+
+  tree.proven(n) = all_won ? ProvenState::PROVEN_LOSS : ProvenState::PROVEN_DRAW;
+  return true;
 }
 
-float MCTS::defaultPolicy(Node* n) {
+float MCTS::defaultPolicy(NodeId n, const Board& board, const Color player) {
   if(do_debug)
     std::cerr << "default policy" << std::endl;
-  Board current_board = n->board;
+  SEARCH_STATS_TIMER(active_stats_, default_policy_ns);
+
+  Board current_board = board;
 
-  MoveSelection selector(current_board);
+  MoveSelection selector(current_board, &rng_);
   selector.setCache(cache_);
+  selector.setPolicy(rollout_policy_);
   Evaluator eval(current_board, cache_);
 
-  Color current_player = n->player;
+  Color current_player = player;
 
   auto evaluation = eval(current_player);
 
+  // Game over positions are solved here, the first time they're reached,
+  // and never get expanded.
+  if(tree_->proven(n) == ProvenState::UNPROVEN)
+    tree_->proven(n) = provenFromEvaluation(evaluation, player);
+
+  // Same units as the rollout result: material in pawns for the player to move.
+  // A mate at the end of a capture sequence isn't a proof (the quiet moves
+  // weren't searched), so it's scored as the biggest material edge instead of
+  // a mate score that would swamp every other visit.
+  if(leaf_eval_ == LeafEvaluation::QUIESCENCE && evaluation.state == State::NORMAL) {
+    Quiescence quiescence;
+    float value = quiescence.search(board, player) / 100.f;
+    return std::clamp(value, -kMaxLeafValue, kMaxLeafValue);
+  }
+
+  if(evaluation.state == State::NORMAL) SEARCH_STATS_ADD(active_stats_, rollouts, 1);
+#ifndef CHESS_NO_SEARCH_STATS
+  const uint64_t allocations = active_stats_ ? threadAllocCounts().allocations : 0;
+#endif
+
   while(evaluation.state == State::NORMAL) {
    
     Move m;
 
+    SEARCH_STATS_ADD(active_stats_, move_generations, 1);
     if(!selector.getMoveForPlayer(current_player, &m)) break;
+    SEARCH_STATS_ADD(active_stats_, rollout_plies, 1);
+    if(rave_equivalence_ > 0) played_.push_back(m.pack());
     // fmt::print("{} does: {}\n", current_player == Color::WHITE? "White" : "Black",
     //                                       current_board.moveToAlgebraicNotation(m));
 
@@ -338,88 +844,152 @@ float MCTS::defaultPolicy(Node* n) {
     evaluation = eval(current_player);
   }
 
-  return eval(n->player).value;
+  float value = eval(player).value;
+  SEARCH_STATS_ADD(active_stats_, rollout_allocations, threadAllocCounts().allocations - allocations);
+  return value;
 }
 
-void MCTS::backPropagate(Node* n, const float value) {
+void MCTS::backPropagate(float value) {
   if(do_debug)
     std::cerr << "back prop" << std::endl;
-  Node* current_node = n;
-
-  while(current_node != nullptr) {
-    current_node->expand_count += 1;
-    current_node->value += value;
-    current_node = current_node->parent;
+  SEARCH_STATS_TIMER(active_stats_, back_propagate_ns);
+  Tree& tree = *tree_;
+  bool check_proven = tree.proven(path_.back()) != ProvenState::UNPROVEN;
+
+  // Each node keeps score for the player who moved into it, which is the
+  // opponent of whoever is to move there.
+  float node_value = -value;
+  for(size_t i = path_.size(); i-- > 0;) {
+    tree.visits(path_[i]) += 1;
+    tree.value(path_[i]) += node_value;
+    node_value = -node_value;
+    // Keep re-solving ancestors only while the result keeps changing
+    if(check_proven && i > 0)
+      check_proven = updateProven(path_[i - 1]);
   }
+
+  if(rave_equivalence_ > 0) updateAmaf(value);
 }
 
-// Run through many iterations to build a huge tree, mainly for evaluating hashes
-// returns heap-allocated because I'm lazy
-Node buildBigTree(Board start_board, size_t num_runs, CachePtr cache) {
-  Node root(start_board, Color::WHITE, Move(0,0,0,0));
-  
-  // Do one move num_runs times
-  for(size_t i = 0; i < num_runs; ++i) {
-    Board local_board = start_board;
-    MoveSelection selector(local_board);
-    selector.setCache(cache);
-    Move m;
-    if(do_assert) {
-      assert(selector.getMoveForPlayer(Color::WHITE, &m));
+void MCTS::updateAmaf(float value) {
+  Tree& tree = *tree_;
+  const Color root_player = tree[tree.root()].player;
+  const Color leaf_player = tree[path_.back()].player;
+
+  if(amaf_seen_.empty()) amaf_seen_.assign(2 << 16, 0);
+  ++amaf_stamp_;
+
+  // played_[j] is made by the player to move at path_[j]. Walking up, the moves
+  // seen so far are exactly the ones played at or below the current node.
+  size_t j = played_.size();
+  for(size_t i = path_.size(); i-- > 0;) {
+    while(j > i) {
+      --j;
+      Color mover = static_cast<Color>(root_player ^ (j & 1));
+      amaf_seen_[(mover << 16) | played_[j]] = amaf_stamp_;
     }
-    local_board.doMove(m, Color::WHITE);
-    root.children.emplace_back(local_board, static_cast<Color>(!Color::WHITE), m);
-    root.children.back().parent = &root;
-  }
-  
-
-  // run each of those to the end
-  for(size_t i = 0; i < num_runs; ++i) {
-    Node* node = &root.children.at(i);
-
-    Board board = node->board;
-    MoveSelection selector(board);
-    selector.setCache(cache);
-    Evaluator eval(board, cache);
 
-    Color current_player = node->player;
-
-    auto evaluation = eval(current_player);
-
-    while(evaluation.state == State::NORMAL) {
-      Move m;
+    const Node& n = tree[path_[i]];
+    float reward = n.player == leaf_player ? value : -value;
+    for(NodeId c = n.first_child; c < n.first_child + n.num_children; ++c) {
+      if(amaf_seen_[(n.player << 16) | tree[c].last_move] != amaf_stamp_) continue;
+      tree.amafVisits(c) += 1;
+      tree.amafValue(c) += reward;
+    }
+  }
+}
 
-      if(!selector.getMoveForPlayer(current_player, &m)) break;
+} // namespace chess
 
-      board.doMove(m, current_player);
 
-      current_player = static_cast<Color>(!current_player);
+namespace po = boost::program_options;
 
-      evaluation = eval(current_player);
+static std::string stripCheckSuffix(std::string s) {
+  if(!s.empty() && (s.back() == '+' || s.back() == '#')) s.pop_back();
+  return s;
+}
 
-      node->children.emplace_back(board, current_player, m);
-      Node& child = node->children.back();
-      child.parent = node;
-      node = &child;
+// Read moves from stdin, in algebraic notation, coordinates (e7e5) or as
+// Move::str(), until one is legal for player. Null at the end of input or on "quit", or if player has no moves.
+static chess::Move readMove(const chess::Board& board, const chess::Color player) {
+  chess::Move result;
+  result.is_null = true;
+
+  chess::MoveGenerator move_gen(board);
+  chess::MoveList moves = move_gen.getMovesForPlayer(player);
+  if(moves.empty()) return result;
+
+  std::string input;
+  while(std::cin >> input && input != "quit") {
+    input = stripCheckSuffix(input);
+    for(const chess::Move& m : moves) {
+      if(m.str() == input || m.uci(player) == input
+         || stripCheckSuffix(board.moveToAlgebraicNotation(m)) == input)
+        return m;
     }
+    std::cerr << "Illegal move: " << input << std::endl;
   }
-  return root;
+  return result;
 }
 
-} // namespace chess
-
-namespace po = boost::program_options;
-
 int main(int argc, char** argv) {
   std::string fname;
+  std::string fen;
+  std::string engine = "mcts";
   bool is_black{false};
   int time_limit_ms = 1000;
+  int max_depth = chess::kMaxPly - 1;
+  int num_threads = 1;
+  std::string leaf_eval = "rollout";
+  std::string rollout_policy = "uniform";
+  bool transpositions{false};
+  float rave_equivalence = 0;
+  float widening_c = 0;
+  float widening_exponent = 0.5;
+  uint64_t seed = 0;
+  std::string stats_json;
+  std::string dot_file;
+  chess::DotOptions dot_options;
+  dot_options.max_depth = 4;
+  dot_options.max_nodes = 5000;
+  bool tree_stats{false};
+  int compare_hashes = 0;
+  std::string save_tree;
+  std::string load_tree;
+  bool ponder{false};
+  bool uci{false};
+  bool bench{false};
+  size_t bench_iterations = 300;
 
   po::options_description desc{"Options"};
   desc.add_options()
-    ("board-file,b", po::value<std::string>(&fname)->required(), "File with board desc")
+    ("board-file,b", po::value<std::string>(&fname), "File with board desc")
+    ("fen", po::value<std::string>(&fen), "Position to search as FEN, instead of a board file")
     ("exploration,c", po::value<float>(&exploration_constant), "Exploration constant")
     ("time,t", po::value<int>(&time_limit_ms), "Time Limit (ms)")
+    ("engine,e", po::value<std::string>(&engine), "Search engine: mcts or alphabeta")
+    ("depth", po::value<int>(&max_depth), "Max depth for alphabeta")
+    ("threads", po::value<int>(&num_threads), "Search threads for alphabeta (Lazy SMP)")
+    ("leaf", po::value<std::string>(&leaf_eval), "MCTS leaf evaluation: rollout or qsearch")
+    ("rollout", po::value<std::string>(&rollout_policy), "MCTS rollout moves: uniform or weighted")
+    ("dag", po::bool_switch(&transpositions), "MCTS shares nodes between transpositions")
+    ("rave", po::value<float>(&rave_equivalence), "MCTS RAVE equivalence parameter (0 = off)")
+    ("widening", po::value<float>(&widening_c), "MCTS progressive widening: children = C * visits^exp (0 = off)")
+    ("widening-exp", po::value<float>(&widening_exponent), "Exponent for --widening")
+    ("seed", po::value<uint64_t>(&seed), "MCTS random seed, for reproducible runs")
+    ("stats-json", po::value<std::string>(&stats_json), "Write MCTS search stats as JSON to this file (- for stdout)")
+    ("dot", po::value<std::string>(&dot_file), "After an MCTS search, write the tree as graphviz to this file")
+    ("dot-depth", po::value<int>(&dot_options.max_depth), "Plies of the tree to write with --dot (-1 for all)")
+    ("dot-max-nodes", po::value<size_t>(&dot_options.max_nodes), "Nodes to write with --dot at most (0 for all)")
+    ("dot-top-k", po::value<size_t>(&dot_options.top_k), "Only write the k most visited children of each node (0 for all)")
+    ("tree-stats", po::bool_switch(&tree_stats), "After an MCTS search, print tree size and depth")
+    ("compare-hashes", po::value<int>(&compare_hashes), "After an MCTS search, compare board hashes over this many nodes")
+    ("save-tree", po::value<std::string>(&save_tree), "Save the MCTS tree to this file when the search ends")
+    ("load-tree", po::value<std::string>(&load_tree), "Continue the MCTS search from a tree saved with --save-tree")
+    ("ponder", po::bool_switch(&ponder), "Play on from the board, reading the opponent's moves from stdin and searching while waiting for them")
+    ("uci", po::bool_switch(&uci), "Speak UCI on stdin/stdout instead of searching one position (MCTS only)")
+    ("bench", po::bool_switch(&bench), "Time MCTS over a fixed set of positions and print a signature of the result")
+    ("bench-iterations", po::value<size_t>(&bench_iterations), "MCTS iterations per position for --bench")
     ("verbose,v", po::bool_switch(&format_verbose), "If set, dot graph is verbose w./ stats")
     ("debug,d", po::bool_switch(&do_debug), "If set, prints debugs")
     ("assert,a", po::bool_switch(&do_assert), "If set, asserts sanity checks")
@@ -429,17 +999,120 @@ int main(int argc, char** argv) {
   po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
   po::notify(vm);
 
-  chess::Board starting_board(fname);
+  if(fname.empty() && fen.empty() && !uci && !bench) {
+    std::cerr << "A board file or FEN is required" << std::endl;
+    return 1;
+  }
+  if((uci || bench) && engine != "mcts") {
+    std::cerr << "--uci and --bench only work with the mcts engine" << std::endl;
+    return 1;
+  }
+
+  chess::Board starting_board;
+  chess::Color player = is_black ? chess::Color::BLACK : chess::Color::WHITE;
+  if(!fen.empty()) {
+    if(!starting_board.setFen(fen, &player)) {
+      std::cerr << "Invalid FEN: " << fen << std::endl;
+      return 1;
+    }
+  } else if(!fname.empty()) {
+    starting_board.setBoardFromFile(fname);
+  }
+
+  chess::Move result;
+  if(engine == "alphabeta") {
+    chess::LazySMP smp(time_limit_ms, num_threads, max_depth);
+    result = smp.search(starting_board, player);
+  } else if(engine == "mcts") {
+    chess::MCTS mcts(time_limit_ms);
+    mcts.setTranspositions(transpositions);
+    mcts.setRave(rave_equivalence);
+    mcts.setProgressiveWidening(widening_c, widening_exponent);
+    if(vm.count("seed")) mcts.setSeed(seed);
+    mcts.setCollectStats(!stats_json.empty());
+    mcts.setSnapshotFile(save_tree);
+    if(!load_tree.empty()) {
+      try {
+        chess::TreeSnapshot snapshot(load_tree);
+        mcts.setTree(std::make_unique<chess::Tree>(snapshot));
+      } catch(const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+      }
+    }
+    if(leaf_eval == "qsearch") {
+      mcts.setLeafEvaluation(chess::LeafEvaluation::QUIESCENCE);
+    } else if(leaf_eval != "rollout") {
+      std::cerr << "Unknown leaf evaluation: " << leaf_eval << std::endl;
+      return 1;
+    }
+    if(rollout_policy == "weighted") {
+      mcts.setRolloutPolicy(chess::RolloutPolicy::WEIGHTED_ROLLOUT);
+    } else if(rollout_policy != "uniform") {
+      std::cerr << "Unknown rollout policy: " << rollout_policy << std::endl;
+      return 1;
+    }
+
+    if(bench) {
+      // Fixed seed unless one is given, so the signature is comparable between runs
+      return chess::runBench(&mcts, bench_iterations, vm.count("seed") ? seed : 1, CHESS_CONFIG_DIR);
+    }
+
+    if(uci) {
+      chess::UCI protocol(&mcts, time_limit_ms);
+      protocol.loop();
+      return 0;
+    }
 
-  chess::MCTS mcts(time_limit_ms);
+    if(ponder) {
+      chess::Board board = starting_board;
+      const chess::Color other = static_cast<chess::Color>(!player);
+      while(true) {
+        chess::Move m = mcts.uctSearch(board, player);
+        if(m.is_null) break;
+        fmt::print("{}\n", board.moveToAlgebraicNotation(m));
+        std::fflush(stdout);
+        board.doMove(m, player);
+
+        mcts.advance(m);
+        mcts.startPondering(board, other);
+        chess::Move reply = readMove(board, other);
+        size_t pondered = mcts.stopPondering();
+        if(reply.is_null) break;
+
+        bool kept = mcts.advance(reply);
+        fmt::print("Pondered {} iterations{}\n", pondered, kept ? "" : ", reply not in tree");
+        board.doMove(reply, other);
+      }
+      return 0;
+    }
 
-  // auto node = chess::buildBigTree(starting_board, time_limit_ms);
+    result = mcts.uctSearch(starting_board, player);
+    // Report the move before any diagnostics, which can take longer than the search
+    std::cerr << result.str() << std::endl;
 
-  // node.generateDotFile("graph.dot");
-  // node.printStats();
-  // node.compareHashes();
- 
-  auto result = mcts.uctSearch(starting_board, chess::Color::WHITE);
+    // The graph is written in the background while the other diagnostics run
+    dot_options.verbose = format_verbose;
+    std::thread dot_writer;
+    if(!dot_file.empty()) {
+      dot_writer = std::thread([&]() { mcts.tree().generateDotFile(dot_file, dot_options); });
+    }
+
+    if(tree_stats) mcts.tree().printStats();
+    if(compare_hashes > 0) mcts.tree().compareHashes(compare_hashes);
+    if(dot_writer.joinable()) dot_writer.join();
+
+    if(stats_json == "-") {
+      fmt::print("{}\n", mcts.stats().toJson());
+    } else if(!stats_json.empty()) {
+      std::ofstream stats_file(stats_json);
+      stats_file << mcts.stats().toJson() << std::endl;
+    }
+    return 0;
+  } else {
+    std::cerr << "Unknown engine: " << engine << std::endl;
+    return 1;
+  }
   std::cerr << result.str() << std::endl;
   return 0;
 }
@@ -5,122 +5,367 @@
 #include <chrono>
 #include <unordered_map>
 #include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <thread>
 
 #include "search/cache_fwd.hh"
 #include "board/board.hh"
+#include "move_selector/move_selection.hh"
+#include "search/search_stats.hh"
 
 namespace chess {
 
-struct Node {
-  
-  Board board;
-  const Color player;
-  const Move last_move;
+// Game-theoretic value of a node from the point of view of the player to move there.
+// Set once a terminal position is reached and backed up by MCTS-Solver rules.
+enum ProvenState : uint8_t {
+  UNPROVEN = 0,
+  PROVEN_WIN,
+  PROVEN_LOSS,
+  PROVEN_DRAW
+};
 
-  Node* parent = nullptr;
+using NodeId = uint32_t;
+constexpr NodeId kNullNode = std::numeric_limits<NodeId>::max();
 
-  size_t expand_count{0};
-  float value{0};
+// One position in the MCTS tree. Only the move leading here is kept; the board
+// is rebuilt by replaying moves from the root on the way down. Statistics live
+// in the Tree's per-node arrays.
+struct Node {
+  PackedMove last_move{kNullPackedMove};
+  Color player{Color::WHITE};
+  // In graph mode, last_move led back to a position on the path. The slot
+  // then scores as a draw with stats of its own instead of linking there.
+  bool repetition{false};
+
+  // Children are one contiguous block in the Tree, one slot per legal move,
+  // allocated the first time this node is expanded. Slots [0, num_expanded)
+  // have been visited; the rest are moves not tried yet, in the order they
+  // will be tried.
+  NodeId first_child{kNullNode};
+  uint16_t num_children{0};
+  uint16_t num_expanded{0};
+
+  // In graph mode, a slot whose position was already in the tree points at
+  // that node instead of growing its own subtree
+  NodeId link{kNullNode};
+
+  Node() = default;
+  Node(PackedMove m, Color p) : last_move(m), player(p) {}
+
+  bool movesGenerated() const { return first_child != kNullNode; }
+};
 
-  MoveList unexplored_children;
-  std::vector<Node> children;
+class TreeSnapshot;
 
-  Node(const Board b, const Color p, const Move m):
-    board(b),
-    player(p),
-    last_move(m)
-  {}
+// What Tree::writeDot puts in the graph
+struct DotOptions {
+  int max_depth{-1};    // plies below the root, -1 for no limit
+  size_t max_nodes{0};  // 0 for no limit
+  size_t top_k{0};      // most visited children per node, 0 for all
+  bool verbose{false};  // label nodes with their stats
+};
 
-  
-  bool operator==(const Node& other) {
-    return board == other.board && player == other.player;
+// Flat storage for the MCTS tree. Nodes refer to each other by index, so the
+// pool can grow without fixing up pointers.
+//
+// Statistics are kept structure-of-arrays, indexed by NodeId. A child block's
+// numbers are then contiguous, which is what bestChild scans.
+class Tree {
+ public:
+  Tree(const Board& board, const Color player);
+
+  // Copy of a saved tree, to search on from: every array is copied out of the
+  // mapping, so this costs as much as the snapshot is big. The position table
+  // for graph mode isn't saved; see rebuildPositions.
+  explicit Tree(const TreeSnapshot& snapshot);
+
+  NodeId root() const { return 0; }
+  const Board& rootBoard() const { return root_board_; }
+  Color rootPlayer() const { return nodes_[0].player; }
+
+  Node& operator[](NodeId id) { return nodes_[id]; }
+  const Node& operator[](NodeId id) const { return nodes_[id]; }
+
+  // Simulations through the node, and their summed result from the point of
+  // view of the player who made last_move
+  uint32_t& visits(NodeId id) { return visits_[id]; }
+  uint32_t visits(NodeId id) const { return visits_[id]; }
+  float& value(NodeId id) { return values_[id]; }
+  float value(NodeId id) const { return values_[id]; }
+
+  ProvenState& proven(NodeId id) { return proven_[id]; }
+  ProvenState proven(NodeId id) const { return proven_[id]; }
+
+  // All-moves-as-first: simulations from the parent in which last_move was
+  // played at any later point by the same player. Belongs to the slot, not
+  // to the node it may link to.
+  uint32_t& amafVisits(NodeId id) { return amaf_visits_[id]; }
+  uint32_t amafVisits(NodeId id) const { return amaf_visits_[id]; }
+  float& amafValue(NodeId id) { return amaf_values_[id]; }
+  float amafValue(NodeId id) const { return amaf_values_[id]; }
+
+  // Copy the stats of the nodes that parent's linked slots point at into the
+  // slots, so its child block can be scanned without resolving each one
+  void syncLinks(NodeId parent);
+
+  // Reserve a block of count child slots for parent. Invalidates Node references.
+  NodeId addChildren(NodeId parent, size_t count);
+
+  // Allocated slots, including moves that were never tried
+  size_t size() const { return nodes_.size(); }
+
+  // The node holding id's stats: itself, or what it links to
+  NodeId resolve(NodeId id) const {
+    return nodes_[id].link == kNullNode ? id : nodes_[id].link;
   }
 
-  bool operator!=(const Node& other) {
-    return !(*this == other);
+  // Position table for graph mode, keyed by positionKey. Returns kNullNode if
+  // the position hasn't been seen. The board is checked, so a key collision
+  // is only a missed transposition.
+  NodeId findPosition(uint64_t key, const Board& board) const;
+  void addPosition(uint64_t key, const Board& board, NodeId id) {
+    positions_.emplace(key, std::make_pair(board, id));
   }
 
-  void printStats() {
-    fmt::print("Tree Size: {} Nodes\n", treeSize());
-    fmt::print("Tree Depth: {}\n", treeDepth());
-  }
+  // Keep only the subtree under id, which becomes the root; board is its
+  // position. Graph-mode links into the kept part survive, the rest is freed.
+  void reroot(NodeId id, const Board& board);
 
-  size_t treeDepth() {
-    return treeDepthHelper() - 1;
-  }
+  // Refill the position table from the nodes already in the tree (replays
+  // every visited move, so only worth it when resuming a saved search)
+  void rebuildPositions();
 
-  size_t treeDepthHelper() {
-    size_t max_child_depth = 0;
-    for(auto& c : children) {
-      size_t child_depth = c.treeDepthHelper();
-      if(child_depth > max_child_depth)
-        max_child_depth = child_depth;
-    }
+  // Diagnostics. These walk the whole tree (or up to the given bound), so
+  // they're only run on request, after the search has returned.
+  void printStats() const;
 
-    return 1 + max_child_depth;
-  }
+  // Only counts visited nodes
+  size_t treeDepth() const;
+  size_t treeSize() const;
 
-  size_t treeSize() {
-    size_t count = 1;
+  // Times and checks for collisions in both board hashes over the first
+  // max_nodes visited nodes, depth first
+  void compareHashes(size_t max_nodes = 10000) const;
 
-    for(auto& c : children) {
-      count += c.treeSize();
-    }
+  // Streams the tree out as graphviz, most visited children first, stopping at
+  // the limits in options. Only reads the tree, so it can run on another thread
+  // once the search is done (the Tree must outlive it).
+  void writeDot(std::ostream& os, const DotOptions& options) const;
+  void generateDotFile(const std::string& out_fname, const DotOptions& options) const;
 
-    return count;
-  }
+ private:
+  using TimeMap = std::unordered_map<size_t, std::pair<std::pair<Board, Color>, size_t>>;
+
+  size_t treeDepthHelper(NodeId id) const;
+  size_t treeSizeHelper(NodeId id) const;
 
-  using TimeMap = std::unordered_map<size_t, std::pair<Node,size_t>>;
+  void compareHashesHelper(NodeId id, const Board& board, size_t& budget,
+                           TimeMap& sdbm_time, size_t& sdbm_collisions,
+                           TimeMap& djb2_time, size_t& djb2_collisions) const;
 
-  void compareHashes();
+  void rebuildPositionsHelper(NodeId id, const Board& board);
 
-  void compareHashesHelper(TimeMap& sdbm_time, size_t& sdbm_collisions,
-                           TimeMap& djb2_time, size_t& djb2_collisions);
+  friend bool saveSnapshot(const Tree& tree, const std::string& fname);
 
+  void writeDotNode(std::ostream& os, const DotOptions& options, NodeId id,
+                    const Board& parent_board, int depth, float uct_val, size_t* emitted) const;
 
-  void generateDotFile(std::string out_fname, int max_depth = -1);
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> visits_;
+  std::vector<float> values_;
+  std::vector<ProvenState> proven_;
+  std::vector<uint32_t> amaf_visits_;
+  std::vector<float> amaf_values_;
 
-  std::vector<std::string> generateDotHelper(int max_depth, int& node_idx, float uct_val) const;
+  Board root_board_;
+
+  std::unordered_map<uint64_t, std::pair<Board, NodeId>> positions_;
 };
 
 
+// How MCTS scores a freshly expanded node
+enum LeafEvaluation {
+  ROLLOUT,    // random playout to the end of the game
+  QUIESCENCE  // capture-only search on the node itself
+};
+
 class MCTS {
 
  public:
 
   MCTS(int time_limit_ms);
+  ~MCTS();
 
-  Move uctSearch(const Board& board, const Color player);
+  // Negative for no limit: search until aborted (or the root is proven)
+  void setTimeLimit(int time_limit_ms) { time_limit_ms_ = time_limit_ms; }
 
-  Node* treePolicy(Node* n);
+  // Stop after this many iterations, 0 for no limit
+  void setIterationLimit(size_t iterations) { iteration_limit_ = iterations; }
 
-  Node* expand(Node* n);
+  // Polled every iteration; setting it makes uctSearch return promptly
+  void setAbortFlag(const std::atomic<bool>* abort) { abort_ = abort; }
 
-  Node* bestChild(Node* n);
+  // If false, don't print the iteration count after each search
+  void setVerbose(bool verbose) { verbose_ = verbose; }
 
-  float defaultPolicy(Node* n);
+  // Iterations done by the last uctSearch
+  size_t iterations() const { return iterations_; }
 
-  void backPropagate(Node* n, const float value);
-  
- private:
-  int time_limit_ms_;
-  CachePtr cache_;
-};
+  // Forget the tree and the cache
+  void newGame();
 
+  void setLeafEvaluation(LeafEvaluation leaf_eval) { leaf_eval_ = leaf_eval; }
 
-}
+  void setRolloutPolicy(RolloutPolicy policy) { rollout_policy_ = policy; }
+
+  // Fixes the move choices in expand and the rollouts (otherwise seeded from
+  // std::random_device)
+  void setSeed(uint64_t seed) { rng_.seed(seed); }
+
+  // Gather counters and phase timings during uctSearch (off by default; the
+  // hooks are only a null check when off)
+  void setCollectStats(bool collect) { collect_stats_ = collect; }
+
+  // From the last uctSearch, if collecting
+  const SearchStats& stats() const { return stats_; }
 
+  // If true, positions reached by different move orders share one node, so the
+  // tree becomes a graph and their statistics are pooled
+  void setTranspositions(bool transpositions) { transpositions_ = transpositions; }
 
-namespace std {
+  // Blend RAVE into selection. equivalence is the visit count at which a child's
+  // own value and its AMAF value get equal weight; 0 turns RAVE off.
+  void setRave(float equivalence) { rave_equivalence_ = equivalence; }
 
-template <>
-struct hash<chess::Node>
-{
-  size_t operator()(const chess::Node& node) const {
-    // XOR with 31 bits followed by a 0 or 1
-    // This guarantees that the hash is different for different colors 
-    return std::hash<chess::Board>{}(node.board) ^ node.player;
+  // Only let a node try c * visits^exponent of its moves, best prior first.
+  // c of 0 turns widening off: every move is tried (in random order) before
+  // any child is revisited.
+  void setProgressiveWidening(float c, float exponent) {
+    widening_c_ = c;
+    widening_exponent_ = exponent;
   }
+
+  Move uctSearch(const Board& board, const Color player);
+
+  // Tree from the last uctSearch, for diagnostics
+  const Tree& tree() const { return *tree_; }
+
+  // The next uctSearch carries on from tree instead of starting over, if it's
+  // for the same position
+  void setTree(std::unique_ptr<Tree> tree) {
+    tree_ = std::move(tree);
+    resume_tree_ = true;
+  }
+
+  // Save the tree to this file at the end of every uctSearch (see tree_snapshot.hh)
+  void setSnapshotFile(const std::string& fname) { snapshot_file_ = fname; }
+
+  // Move the root down to the child reached by m so the next uctSearch starts
+  // from what's already known there. Returns false, dropping the tree, if m
+  // was never tried.
+  bool advance(const Move& m);
+
+  // Keep searching on a background thread until stopPondering, from the tree
+  // for board if there is one. Meant for the opponent's turn: called after
+  // advancing past our own move, it spreads over all their replies, and once
+  // the real one is known advance keeps just its subtree.
+  void startPondering(const Board& board, const Color player);
+
+  // Returns the iterations done since startPondering (0 if not pondering)
+  size_t stopPondering();
+
+  // Reuse the tree if it was handed over for this position, otherwise start a new one
+  void prepareTree(const Board& board, const Color player);
+
+  // The search loop. Stops after time_limit_ms (never if negative), after
+  // max_iterations (never if 0), on stopPondering or when aborted, though
+  // the time limit and abort only count after the first iteration.
+  // Returns the iterations done.
+  size_t runIterations(const Board& board, const Color player, int time_limit_ms,
+                       size_t max_iterations);
+
+  // Walk down from the root, replaying moves onto board and recording the path.
+  // Returns the node to score, with board and player set to its position.
+  // Sets *repetition instead if the walk came back to a position on the path.
+  NodeId treePolicy(Board* board, Color* player, bool* repetition);
+
+  // Push the node holding slot's stats onto the path and return it. A slot
+  // that leads back to a node already on the path (graph mode only) becomes a
+  // repetition: it's pushed itself and *repetition is set.
+  NodeId enterChild(NodeId slot, bool* repetition);
+
+  // Try one more of n's moves. board and player are n's position on entry
+  // and the new child's on return. Returns the new child's slot, which in
+  // graph mode can link to a node that was already there, or n itself if it
+  // turned out to be the end of the game.
+  NodeId expand(NodeId n, Board* board, Color* player);
+
+  // How many of n's moves may have been tried at its current visit count
+  size_t expansionLimit(NodeId n) const;
+
+  // Skips children whose result is already proven. Returns kNullNode if none are left.
+  // Returns the child slot, which may link elsewhere in graph mode.
+  NodeId bestChild(NodeId n);
+
+  // The child to actually play: a proven win if there is one, otherwise the best
+  // unproven child, otherwise the least bad proven one.
+  NodeId finalChild(NodeId n);
+
+  // Score of the position for player, who is to move in it
+  float defaultPolicy(NodeId n, const Board& board, const Color player);
+
+  // value is from the point of view of the player to move at the end of the path
+  void backPropagate(float value);
+
+  // Credit every child slot along the path whose move its player made later on
+  void updateAmaf(float value);
+
+  // Allocate n's child block, one slot per legal move, in the order expand
+  // should try them: by prior if widening, shuffled otherwise
+  void generateMoves(NodeId n, const Board& board, const Color player);
+
+  // Re-derive n's proven state from its children. Returns true if it just became proven.
+  bool updateProven(NodeId n);
+  
+ private:
+  int time_limit_ms_;
+  size_t iteration_limit_{0};
+  const std::atomic<bool>* abort_{nullptr};
+  bool verbose_{true};
+  size_t iterations_{0};
+  LeafEvaluation leaf_eval_{LeafEvaluation::ROLLOUT};
+  RolloutPolicy rollout_policy_{RolloutPolicy::UNIFORM_ROLLOUT};
+  bool transpositions_{false};
+  float rave_equivalence_{0};
+  float widening_c_{0};
+  float widening_exponent_{0.5};
+  CachePtr cache_;
+  Random rng_;
+
+  bool collect_stats_{false};
+  SearchStats stats_;
+  // &stats_ while a search is collecting, nullptr otherwise
+  SearchStats* active_stats_{nullptr};
+
+  std::unique_ptr<Tree> tree_;
+  bool resume_tree_{false};
+  std::string snapshot_file_;
+  // Nodes visited by the current iteration, root first
+  std::vector<NodeId> path_;
+  // Every move of the current iteration, tree and rollout, starting from the root
+  std::vector<PackedMove> played_;
+
+  // [color][packed move] -> last iteration that saw it, so it never needs clearing
+  std::vector<uint32_t> amaf_seen_;
+  uint32_t amaf_stamp_{0};
+
+  std::thread ponder_thread_;
+  std::atomic<bool> stop_pondering_{false};
+  size_t ponder_iterations_{0};
 };
 
+
 }
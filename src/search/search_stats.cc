@@ -0,0 +1,27 @@
+#include <fmt/format.h>
+
+#include "search/search_stats.hh"
+
+namespace chess {
+
+std::string SearchStats::toJson() const {
+  double seconds = total_ns / 1e9;
+  double ips = seconds > 0 ? iterations / seconds : 0;
+  double allocs_per_iteration = iterations > 0 ? double(allocations) / iterations : 0;
+  double allocs_per_rollout = rollouts > 0 ? double(rollout_allocations) / rollouts : 0;
+
+  return fmt::format(
+      "{{\"iterations\": {}, \"rollouts\": {}, \"rollout_plies\": {}, "
+      "\"move_generations\": {}, \"cache_hits\": {}, \"cache_misses\": {}, "
+      "\"max_depth\": {}, \"tree_nodes\": {}, \"allocations\": {}, \"rollout_allocations\": {}, "
+      "\"allocations_per_iteration\": {:.2f}, \"allocations_per_rollout\": {:.2f}, "
+      "\"tree_policy_ms\": {:.3f}, \"expand_ms\": {:.3f}, \"default_policy_ms\": {:.3f}, "
+      "\"back_propagate_ms\": {:.3f}, \"total_ms\": {:.3f}, \"iterations_per_second\": {:.1f}}}",
+      iterations, rollouts, rollout_plies, move_generations, cache_hits, cache_misses,
+      max_depth, tree_nodes, allocations, rollout_allocations,
+      allocs_per_iteration, allocs_per_rollout,
+      tree_policy_ns / 1e6, expand_ns / 1e6, default_policy_ns / 1e6,
+      back_propagate_ns / 1e6, total_ns / 1e6, ips);
+}
+
+}
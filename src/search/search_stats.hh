@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace chess {
+
+// Counters and phase timers for one MCTS search. Only gathered when the search
+// is asked for them (MCTS::setCollectStats), and compiled out entirely when
+// CHESS_NO_SEARCH_STATS is defined.
+struct SearchStats {
+  uint64_t iterations{0};
+  uint64_t rollouts{0};
+  uint64_t rollout_plies{0};
+  uint64_t move_generations{0};  // child blocks plus one per rollout ply
+  uint64_t cache_hits{0};
+  uint64_t cache_misses{0};
+  uint64_t max_depth{0};         // deepest path walked by treePolicy
+  uint64_t tree_nodes{0};        // allocated slots at the end
+
+  // Heap allocations by the searching thread (needs alloc_count.cc linked in)
+  uint64_t allocations{0};
+  uint64_t rollout_allocations{0};
+
+  // Nanoseconds. tree_policy includes the time in expand.
+  uint64_t tree_policy_ns{0};
+  uint64_t expand_ns{0};
+  uint64_t default_policy_ns{0};
+  uint64_t back_propagate_ns{0};
+  uint64_t total_ns{0};
+
+  // One flat object, e.g. {"iterations": 1234, ..., "iterations_per_second": 5678.9}
+  std::string toJson() const;
+};
+
+// Adds the time until it goes out of scope to *sink. Doesn't read the clock
+// if sink is nullptr.
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(uint64_t* sink) : sink_(sink) {
+    if(sink_) start_ = std::chrono::steady_clock::now();
+  }
+
+  ~ScopedTimer() {
+    if(sink_) {
+      auto elapsed = std::chrono::steady_clock::now() - start_;
+      *sink_ += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+  }
+
+ private:
+  uint64_t* sink_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}
+
+// stats is a SearchStats*, nullptr when not collecting
+#ifdef CHESS_NO_SEARCH_STATS
+#define SEARCH_STATS_ADD(stats, field, amount) do {} while(0)
+#define SEARCH_STATS_MAX(stats, field, value) do {} while(0)
+#define SEARCH_STATS_TIMER(stats, field) do {} while(0)
+#else
+#define SEARCH_STATS_ADD(stats, field, amount) \
+  do { if(stats) (stats)->field += (amount); } while(0)
+#define SEARCH_STATS_MAX(stats, field, value) \
+  do { if((stats) && (stats)->field < (value)) (stats)->field = (value); } while(0)
+#define SEARCH_STATS_TIMER(stats, field) \
+  ::chess::ScopedTimer field##_timer((stats) ? &(stats)->field : nullptr)
+#endif
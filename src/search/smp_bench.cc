@@ -0,0 +1,71 @@
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <boost/program_options.hpp>
+
+#include "search/lazy_smp.hh"
+
+// Time-to-depth for Lazy SMP: searches every position to a fixed depth with
+// 1..N threads and reports the speedup over a single thread.
+
+namespace po = boost::program_options;
+
+int main(int argc, char** argv) {
+  std::vector<std::string> fnames;
+  int depth = 5;
+  int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  bool is_black{false};
+
+  po::options_description desc{"Options"};
+  desc.add_options()
+    ("board-file,b", po::value<std::vector<std::string>>(&fnames)->required(), "Files with board desc")
+    ("depth", po::value<int>(&depth), "Depth to search every position to")
+    ("threads", po::value<int>(&max_threads), "Largest thread count to try")
+    ("start-black", po::bool_switch(&is_black), "Start with black move");
+
+  po::positional_options_description positional;
+  positional.add("board-file", -1);
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+  po::notify(vm);
+
+  const chess::Color player = is_black ? chess::Color::BLACK : chess::Color::WHITE;
+  // Depth is what's being timed, so the clock never runs out
+  const int no_time_limit = std::numeric_limits<int>::max();
+
+  std::vector<double> total_ms(max_threads + 1, 0);
+  std::vector<size_t> total_nodes(max_threads + 1, 0);
+
+  for(const auto& fname : fnames) {
+    chess::Board board(fname);
+    fmt::print("{} (depth {})\n", fname, depth);
+
+    double single_ms = 0;
+    for(int threads = 1; threads <= max_threads; ++threads) {
+      chess::LazySMP smp(no_time_limit, threads, depth);
+      smp.setVerbose(false);
+
+      auto start = std::chrono::steady_clock::now();
+      chess::Move best = smp.search(board, player);
+      double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count();
+
+      if(threads == 1) single_ms = ms;
+      total_ms[threads] += ms;
+      total_nodes[threads] += smp.nodes();
+
+      fmt::print("  threads {:2d} time {:9.1f} ms nodes {:10d} nps {:9.0f} speedup {:5.2f} best {}\n",
+                 threads, ms, smp.nodes(), smp.nodes() / std::max(ms / 1000, 1e-6),
+                 single_ms / std::max(ms, 1e-6), best.str());
+    }
+  }
+
+  fmt::print("Total\n");
+  for(int threads = 1; threads <= max_threads; ++threads) {
+    fmt::print("  threads {:2d} time {:9.1f} ms nodes {:10d} speedup {:5.2f}\n",
+               threads, total_ms[threads], total_nodes[threads],
+               total_ms[1] / std::max(total_ms[threads], 1e-6));
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include "search/transposition_table.hh"
+
+namespace chess {
+
+TranspositionTable::TranspositionTable(size_t size_mb) {
+  // Round down to a power of two so the slot is just a mask
+  size_t num_slots = 1;
+  while(num_slots * 2 * sizeof(Slot) <= size_mb * 1024 * 1024)
+    num_slots *= 2;
+
+  slots_.reset(new Slot[num_slots]);
+  num_slots_ = num_slots;
+  mask_ = num_slots - 1;
+}
+
+// <bound [56..63]> <depth [48..55]> <score [16..47]> <move [0..15]>
+uint64_t TranspositionTable::packEntry(PackedMove move, int score, int depth, BoundType bound) {
+  return static_cast<uint64_t>(move)
+       | (static_cast<uint64_t>(static_cast<uint32_t>(score)) << 16)
+       | (static_cast<uint64_t>(static_cast<uint8_t>(depth)) << 48)
+       | (static_cast<uint64_t>(bound) << 56);
+}
+
+void TranspositionTable::unpackEntry(uint64_t data, TTEntry* result) {
+  result->move = static_cast<PackedMove>(data & 0xFFFF);
+  result->score = static_cast<int32_t>(static_cast<uint32_t>(data >> 16));
+  result->depth = static_cast<int8_t>((data >> 48) & 0xFF);
+  result->bound = static_cast<BoundType>(data >> 56);
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry* result) const {
+  const Slot& slot = slots_[slotIndex(key, mask_)];
+  uint64_t data = slot.data.load(std::memory_order_relaxed);
+  uint64_t check = slot.check.load(std::memory_order_relaxed);
+
+  // Empty slots have no bound, torn or foreign ones fail the key check
+  if(data == 0 || (check ^ data) != key) return false;
+
+  result->key = key;
+  unpackEntry(data, result);
+  return true;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int score, BoundType bound, PackedMove move) {
+  Slot& slot = slots_[slotIndex(key, mask_)];
+
+  uint64_t old_data = slot.data.load(std::memory_order_relaxed);
+  bool same_key = old_data != 0
+                  && (slot.check.load(std::memory_order_relaxed) ^ old_data) == key;
+
+  if(same_key) {
+    TTEntry old;
+    unpackEntry(old_data, &old);
+    // Keep the deeper result for the same position, but always let a new position in.
+    if(old.depth > depth && bound != BoundType::EXACT_BOUND) return;
+    // Don't lose the best move just because this search didn't find one
+    if(move == kNullPackedMove) move = old.move;
+  }
+
+  uint64_t data = packEntry(move, score, depth, bound);
+  slot.data.store(data, std::memory_order_relaxed);
+  slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+  for(size_t i = 0; i < num_slots_; ++i) {
+    slots_[i].data.store(0, std::memory_order_relaxed);
+    slots_[i].check.store(0, std::memory_order_relaxed);
+  }
+}
+
+}
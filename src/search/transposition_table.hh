@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "board/board.hh"
+
+namespace chess {
+
+// What a stored score tells us about the true value of the position
+enum BoundType : uint8_t {
+  NO_BOUND = 0,
+  EXACT_BOUND,
+  LOWER_BOUND,  // failed high: true score >= stored
+  UPPER_BOUND   // failed low: true score <= stored
+};
+
+struct TTEntry {
+  uint64_t key{0};
+  PackedMove move{kNullPackedMove};
+  int32_t score{0};
+  int8_t depth{-1};
+  BoundType bound{BoundType::NO_BOUND};
+};
+
+// Fixed size, always-replace-if-deeper hash table for alpha-beta search.
+// The key is the full position hash (positionKey); slotIndex picks the slot.
+//
+// Safe to share between search threads without locks: each slot is two 64-bit
+// words, the packed entry and the key XOR'd with it. A slot torn by two threads
+// writing at once no longer matches its key, so it just reads as a miss.
+class TranspositionTable {
+ public:
+  TranspositionTable(size_t size_mb = 64);
+
+  bool probe(uint64_t key, TTEntry* result) const;
+  void store(uint64_t key, int depth, int score, BoundType bound, PackedMove move);
+
+  void clear();
+
+  size_t size() const { return num_slots_; }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> check{0};  // key ^ data
+    std::atomic<uint64_t> data{0};
+  };
+
+  static uint64_t packEntry(PackedMove move, int score, int depth, BoundType bound);
+  static void unpackEntry(uint64_t data, TTEntry* result);
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t num_slots_;
+  uint64_t mask_;
+};
+
+using TTPtr = std::shared_ptr<TranspositionTable>;
+
+}
@@ -0,0 +1,146 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "search/tree_snapshot.hh"
+
+namespace chess {
+
+static_assert(std::is_trivially_copyable<Node>::value, "Nodes are written to snapshots as raw bytes");
+
+static uint64_t alignUp(uint64_t offset) {
+  return (offset + 63) & ~uint64_t(63);
+}
+
+bool saveSnapshot(const Tree& tree, const std::string& fname) {
+  const uint64_t n = tree.size();
+
+  SnapshotHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+  header.version = kSnapshotVersion;
+  header.node_size = sizeof(Node);
+  header.num_nodes = n;
+
+  const Board& board = tree.rootBoard();
+  for(uint8_t file = 0; file < kBoardDim; ++file)
+    for(uint8_t rank = 0; rank < kBoardDim; ++rank)
+      header.root_pieces[file * kBoardDim + rank] = board.getPieceAt(file, rank);
+  header.special_move_flags = board.special_move_flags_;
+  header.root_player = tree.rootPlayer();
+
+  header.nodes_offset = alignUp(sizeof(header));
+  header.visits_offset = alignUp(header.nodes_offset + n * sizeof(Node));
+  header.values_offset = alignUp(header.visits_offset + n * sizeof(uint32_t));
+  header.proven_offset = alignUp(header.values_offset + n * sizeof(float));
+  header.amaf_visits_offset = alignUp(header.proven_offset + n * sizeof(ProvenState));
+  header.amaf_values_offset = alignUp(header.amaf_visits_offset + n * sizeof(uint32_t));
+
+  std::ofstream out(fname, std::ios::binary | std::ios::trunc);
+  if(!out) return false;
+
+  uint64_t written = 0;
+  auto write = [&](uint64_t offset, const void* data, uint64_t bytes) {
+    static const char zeros[64] = {};
+    out.write(zeros, offset - written);
+    out.write(static_cast<const char*>(data), bytes);
+    written = offset + bytes;
+  };
+
+  write(0, &header, sizeof(header));
+  write(header.nodes_offset, tree.nodes_.data(), n * sizeof(Node));
+  write(header.visits_offset, tree.visits_.data(), n * sizeof(uint32_t));
+  write(header.values_offset, tree.values_.data(), n * sizeof(float));
+  write(header.proven_offset, tree.proven_.data(), n * sizeof(ProvenState));
+  write(header.amaf_visits_offset, tree.amaf_visits_.data(), n * sizeof(uint32_t));
+  write(header.amaf_values_offset, tree.amaf_values_.data(), n * sizeof(float));
+
+  return static_cast<bool>(out);
+}
+
+TreeSnapshot::TreeSnapshot(const std::string& fname) {
+  int fd = open(fname.c_str(), O_RDONLY);
+  if(fd < 0) throw std::runtime_error("Can't open snapshot " + fname);
+
+  struct stat st;
+  if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+    close(fd);
+    throw std::runtime_error("Not a tree snapshot: " + fname);
+  }
+  length_ = st.st_size;
+
+  data_ = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file alive on its own
+  close(fd);
+  if(data_ == MAP_FAILED) {
+    data_ = nullptr;
+    throw std::runtime_error("Can't map snapshot " + fname);
+  }
+  header_ = static_cast<const SnapshotHeader*>(data_);
+
+  const SnapshotHeader& h = *header_;
+  bool valid = std::memcmp(h.magic, kSnapshotMagic, sizeof(h.magic)) == 0
+               && h.version == kSnapshotVersion
+               && h.node_size == sizeof(Node)
+               && h.num_nodes > 0 && h.num_nodes < kNullNode
+               && h.root_player <= Color::BLACK
+               && fits<Node>(h.nodes_offset)
+               && fits<uint32_t>(h.visits_offset)
+               && fits<float>(h.values_offset)
+               && fits<ProvenState>(h.proven_offset)
+               && fits<uint32_t>(h.amaf_visits_offset)
+               && fits<float>(h.amaf_values_offset);
+  if(!valid) {
+    munmap(data_, length_);
+    data_ = nullptr;
+    throw std::runtime_error("Not a compatible tree snapshot: " + fname);
+  }
+
+  // The search follows these indices without checking them. Child blocks are
+  // always allocated after their parent, which also rules out cycles.
+  const uint64_t n = h.num_nodes;
+  for(uint64_t i = 0; i < n && valid; ++i) {
+    const Node& node = nodes()[i];
+    valid = node.player <= Color::BLACK
+            && proven()[i] <= ProvenState::PROVEN_DRAW
+            && node.num_expanded <= node.num_children
+            && (node.link == kNullNode || node.link < n)
+            && (node.movesGenerated()
+                  ? node.first_child > i && uint64_t(node.first_child) + node.num_children <= n
+                  : node.num_children == 0);
+  }
+  if(!valid) {
+    munmap(data_, length_);
+    data_ = nullptr;
+    throw std::runtime_error("Corrupt tree snapshot: " + fname);
+  }
+}
+
+template <typename T>
+bool TreeSnapshot::fits(uint64_t offset) const {
+  // num_nodes < 2^32, so the size can't overflow
+  const uint64_t bytes = header_->num_nodes * sizeof(T);
+  return offset % alignof(T) == 0 && offset >= sizeof(SnapshotHeader)
+         && offset <= length_ && bytes <= length_ - offset;
+}
+
+TreeSnapshot::~TreeSnapshot() {
+  if(data_ != nullptr) munmap(data_, length_);
+}
+
+Board TreeSnapshot::rootBoard() const {
+  Board board;
+  for(uint8_t file = 0; file < kBoardDim; ++file)
+    for(uint8_t rank = 0; rank < kBoardDim; ++rank)
+      board.setPieceAt(file, rank, static_cast<Piece>(header_->root_pieces[file * kBoardDim + rank]));
+  board.special_move_flags_ = header_->special_move_flags;
+  return board;
+}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "board/board.hh"
+#include "search/search.hh"
+
+namespace chess {
+
+// On-disk layout of a saved MCTS tree. The header is followed by the Tree's
+// arrays exactly as they sit in memory, each starting on a 64-byte boundary,
+// so a snapshot can be mapped and its arrays read in place.
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t node_size;        // sizeof(Node) when written; a mismatch means a stale format
+  uint64_t num_nodes;
+
+  uint8_t root_pieces[64];   // Piece per square, file * 8 + rank
+  uint8_t special_move_flags;
+  uint8_t root_player;
+  uint8_t padding[6];
+
+  // Byte offsets from the start of the file
+  uint64_t nodes_offset;
+  uint64_t visits_offset;
+  uint64_t values_offset;
+  uint64_t proven_offset;
+  uint64_t amaf_visits_offset;
+  uint64_t amaf_values_offset;
+};
+
+constexpr char kSnapshotMagic[8] = {'M', 'C', 'T', 'S', 'T', 'R', 'E', 'E'};
+constexpr uint32_t kSnapshotVersion = 2;
+
+// Write tree to fname. Returns false if the file couldn't be written.
+bool saveSnapshot(const Tree& tree, const std::string& fname);
+
+// Read-only memory mapping of a snapshot file. The accessors point straight
+// into the mapping, which lives as long as this. Opening one still reads the
+// whole file once, to check every node's indices; searching on from it
+// (Tree's constructor) then copies the arrays, since the search grows them.
+class TreeSnapshot {
+ public:
+  // Throws std::runtime_error if the file can't be mapped, isn't a snapshot,
+  // or has sections or node indices out of bounds
+  explicit TreeSnapshot(const std::string& fname);
+  ~TreeSnapshot();
+
+  TreeSnapshot(const TreeSnapshot&) = delete;
+  TreeSnapshot& operator=(const TreeSnapshot&) = delete;
+
+  size_t size() const { return header_->num_nodes; }
+
+  Board rootBoard() const;
+  Color rootPlayer() const { return static_cast<Color>(header_->root_player); }
+
+  const Node* nodes() const { return at<Node>(header_->nodes_offset); }
+  const uint32_t* visits() const { return at<uint32_t>(header_->visits_offset); }
+  const float* values() const { return at<float>(header_->values_offset); }
+  const ProvenState* proven() const { return at<ProvenState>(header_->proven_offset); }
+  const uint32_t* amafVisits() const { return at<uint32_t>(header_->amaf_visits_offset); }
+  const float* amafValues() const { return at<float>(header_->amaf_values_offset); }
+
+ private:
+  template <typename T>
+  const T* at(uint64_t offset) const {
+    return reinterpret_cast<const T*>(static_cast<const char*>(data_) + offset);
+  }
+
+  // Whether num_nodes Ts at offset lie within the file
+  template <typename T>
+  bool fits(uint64_t offset) const;
+
+  void* data_{nullptr};
+  size_t length_{0};
+  const SnapshotHeader* header_{nullptr};
+};
+
+}
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <chrono>
+
+#include "search/uci.hh"
+#include "move_generator/move_generator.hh"
+
+namespace chess {
+
+UCI::UCI(MCTS* mcts, int default_time_ms, std::istream& in, std::ostream& out) :
+  mcts_(mcts),
+  default_time_ms_(default_time_ms),
+  in_(in),
+  out_(out)
+{
+  base_.setFen(kStartingFen, &base_player_);
+  board_ = base_;
+  mcts_->setAbortFlag(&stop_);
+  mcts_->setVerbose(false);
+}
+
+UCI::~UCI() {
+  stopSearch();
+  mcts_->setAbortFlag(nullptr);
+}
+
+void UCI::loop() {
+  std::string line;
+  while(std::getline(in_, line)) {
+    std::istringstream args(line);
+    std::string command;
+    args >> command;
+
+    if(command == "uci") {
+      send("id name chess\nid author sethgi\nuciok");
+    } else if(command == "isready") {
+      send("readyok");
+    } else if(command == "ucinewgame") {
+      waitSearch();
+      mcts_->newGame();
+      have_tree_ = false;
+    } else if(command == "position") {
+      waitSearch();
+      position(args);
+    } else if(command == "go") {
+      waitSearch();
+      go(args);
+    } else if(command == "stop") {
+      stopSearch();
+    } else if(command == "quit") {
+      break;
+    } else if(command == "d") {
+      std::lock_guard<std::mutex> lock(out_mutex_);
+      out_ << board_ << (player_ == Color::WHITE ? "White" : "Black") << " to move" << std::endl;
+    } else if(!command.empty()) {
+      send("info string unknown command " + command);
+    }
+  }
+  stopSearch();
+}
+
+void UCI::position(std::istringstream& args) {
+  std::string token;
+  args >> token;
+
+  Board base;
+  Color base_player;
+  if(token == "startpos") {
+    base.setFen(kStartingFen, &base_player);
+    args >> token;
+  } else if(token == "fen") {
+    std::string fen;
+    while(args >> token && token != "moves") fen += token + " ";
+    if(!base.setFen(fen, &base_player)) {
+      send("info string invalid fen " + fen);
+      return;
+    }
+  } else {
+    send("info string expected startpos or fen");
+    return;
+  }
+
+  // Nothing changes unless every move is legal
+  Board board = base;
+  Color player = base_player;
+  std::vector<Move> moves;
+  if(token == "moves") {
+    while(args >> token) {
+      MoveGenerator move_gen(board);
+      MoveList legal = move_gen.getMovesForPlayer(player);
+      auto it = std::find_if(legal.begin(), legal.end(),
+                             [&](const Move& m) { return m.uci(player) == token; });
+      if(it == legal.end()) {
+        send("info string illegal move " + token);
+        return;
+      }
+      board.makeMove(*it, player);
+      moves.push_back(*it);
+      player = static_cast<Color>(!player);
+    }
+  }
+
+  if(base != base_ || base_player != base_player_) have_tree_ = false;
+  base_ = base;
+  base_player_ = base_player;
+  board_ = board;
+  player_ = player;
+  moves_.swap(moves);
+}
+
+void UCI::go(std::istringstream& args) {
+  int time_ms = -1;
+  int moves_to_go = 30;
+  int inc_ms = 0;
+  int move_time_ms = -1;
+  size_t nodes = 0;
+  bool infinite = false;
+
+  std::string token;
+  while(args >> token) {
+    if(token == "infinite") infinite = true;
+    else if(token == "wtime" && player_ == Color::WHITE) args >> time_ms;
+    else if(token == "btime" && player_ == Color::BLACK) args >> time_ms;
+    else if(token == "winc" && player_ == Color::WHITE) args >> inc_ms;
+    else if(token == "binc" && player_ == Color::BLACK) args >> inc_ms;
+    else if(token == "movestogo") args >> moves_to_go;
+    else if(token == "movetime") args >> move_time_ms;
+    else if(token == "nodes") args >> nodes;
+  }
+
+  int limit_ms = default_time_ms_;
+  if(infinite) {
+    limit_ms = -1;
+  } else if(move_time_ms >= 0) {
+    limit_ms = move_time_ms;
+  } else if(time_ms >= 0) {
+    // An even share of what's left, never more than half of it
+    limit_ms = std::min(time_ms / std::max(moves_to_go, 1) + inc_ms / 2, time_ms / 2);
+  } else if(nodes > 0) {
+    limit_ms = -1;
+  }
+  mcts_->setTimeLimit(limit_ms);
+  mcts_->setIterationLimit(nodes);
+
+  // Carry the tree over if this position follows on from the one it was grown for
+  if(have_tree_ && tree_moves_.size() <= moves_.size()
+     && std::equal(tree_moves_.begin(), tree_moves_.end(), moves_.begin())) {
+    for(size_t i = tree_moves_.size(); i < moves_.size(); ++i)
+      if(!mcts_->advance(moves_[i])) break;
+  }
+  have_tree_ = true;
+  tree_moves_ = moves_;
+
+  stop_ = false;
+  worker_ = std::thread(&UCI::search, this, board_, player_, infinite);
+}
+
+void UCI::stopSearch() {
+  if(!worker_.joinable()) return;
+  stop_ = true;
+  worker_.join();
+}
+
+void UCI::waitSearch() {
+  if(worker_.joinable()) worker_.join();
+}
+
+void UCI::search(Board board, Color player, bool infinite) {
+  auto start = std::chrono::steady_clock::now();
+  Move best = mcts_->uctSearch(board, player);
+
+  // The search can end early on a proven root, but an infinite one has to
+  // wait for stop before answering
+  while(infinite && !stop_.load(std::memory_order_relaxed))
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  const long ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+  const size_t iterations = mcts_->iterations();
+  send(fmt::format("info nodes {} time {} nps {}", iterations, ms,
+                   iterations * 1000 / std::max<long>(ms, 1)));
+  send("bestmove " + (best.is_null ? std::string("0000") : best.uci(player)));
+}
+
+void UCI::send(const std::string& line) {
+  std::lock_guard<std::mutex> lock(out_mutex_);
+  out_ << line << std::endl;
+}
+
+}
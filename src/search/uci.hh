@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "board/board.hh"
+#include "search/search.hh"
+
+namespace chess {
+
+// Speaks UCI over in and out. Searches run on a worker thread, so commands
+// (stop in particular) are handled while one is going. The MCTS tree and cache
+// outlive each search: a position that carries on from the last one searched
+// keeps the subtree for the moves played since.
+class UCI {
+ public:
+  // default_time_ms is used by a go without any time control
+  UCI(MCTS* mcts, int default_time_ms, std::istream& in = std::cin, std::ostream& out = std::cout);
+  ~UCI();
+
+  // Handle commands until quit or the end of input
+  void loop();
+
+ private:
+  void position(std::istringstream& args);
+  void go(std::istringstream& args);
+
+  // Abort the search if there is one and wait for its bestmove
+  void stopSearch();
+
+  // Wait for the search to finish on its own. Commands other than stop and
+  // quit queue up behind it rather than cutting it short.
+  void waitSearch();
+
+  void search(Board board, Color player, bool infinite);
+
+  void send(const std::string& line);
+
+  MCTS* mcts_;
+  int default_time_ms_;
+  std::istream& in_;
+  std::ostream& out_;
+  std::mutex out_mutex_;
+
+  // Position from the last position command: a start position plus the moves
+  // played from it
+  Board base_;
+  Color base_player_{Color::WHITE};
+  std::vector<Move> moves_;
+  Board board_;
+  Color player_{Color::WHITE};
+
+  // Moves from base_ to the root of the MCTS tree, if there is a tree
+  bool have_tree_{false};
+  std::vector<Move> tree_moves_;
+
+  std::thread worker_;
+  std::atomic<bool> stop_{false};
+};
+
+}
@@ -0,0 +1,129 @@
+#include <cmath>
+#include <limits>
+
+#include "search/uct_select.hh"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CHESS_HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+namespace chess {
+
+static inline float uctScore(const UCTBlock& block, size_t i, float explore, float rave) {
+  float visits = static_cast<float>(block.visits[i]);
+  float mean = block.value[i] / visits;
+  if(rave > 0 && block.amaf_visits[i] > 0) {
+    float beta = std::sqrt(rave / (3 * visits + rave));
+    float amaf_mean = block.amaf_value[i] / static_cast<float>(block.amaf_visits[i]);
+    mean = (1 - beta) * mean + beta * amaf_mean;
+  }
+  return mean + explore / std::sqrt(visits);
+}
+
+size_t uctArgmaxScalar(const UCTBlock& block, float explore, float rave) {
+  size_t best = block.size;
+  float best_score = -std::numeric_limits<float>::infinity();
+  for(size_t i = 0; i < block.size; ++i) {
+    if(block.proven[i]) continue;
+    float score = uctScore(block, i, explore, rave);
+    if(best == block.size || score > best_score) {
+      best_score = score;
+      best = i;
+    }
+  }
+  return best;
+}
+
+#ifdef CHESS_HAVE_AVX2_KERNEL
+
+__attribute__((target("avx2")))
+static size_t uctArgmaxAVX2(const UCTBlock& block, float explore, float rave) {
+  const __m256 neg_inf = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+  const __m256 explore_v = _mm256_set1_ps(explore);
+  const __m256 rave_v = _mm256_set1_ps(rave);
+  const __m256 one = _mm256_set1_ps(1.f);
+  const __m256 three = _mm256_set1_ps(3.f);
+  const __m256i zero = _mm256_setzero_si256();
+  const bool use_rave = rave > 0;
+
+  // Each lane keeps its own best; ties keep the earlier index since later
+  // blocks only replace on strictly greater
+  __m256 best_score = neg_inf;
+  __m256i best_idx = _mm256_set1_epi32(-1);
+  __m256i idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i step = _mm256_set1_epi32(8);
+
+  size_t i = 0;
+  for(; i + 8 <= block.size; i += 8) {
+    __m256 visits = _mm256_cvtepi32_ps(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block.visits + i)));
+    __m256 mean = _mm256_div_ps(_mm256_loadu_ps(block.value + i), visits);
+
+    if(use_rave) {
+      __m256i amaf_visits_i = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block.amaf_visits + i));
+      __m256 amaf_visits = _mm256_cvtepi32_ps(amaf_visits_i);
+      __m256 has_amaf = _mm256_castsi256_ps(
+          _mm256_xor_si256(_mm256_cmpeq_epi32(amaf_visits_i, zero), _mm256_set1_epi32(-1)));
+      __m256 beta = _mm256_sqrt_ps(_mm256_div_ps(rave_v, _mm256_add_ps(_mm256_mul_ps(three, visits), rave_v)));
+      __m256 amaf_mean = _mm256_div_ps(_mm256_loadu_ps(block.amaf_value + i),
+                                       _mm256_max_ps(amaf_visits, one));
+      __m256 blended = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(one, beta), mean),
+                                     _mm256_mul_ps(beta, amaf_mean));
+      mean = _mm256_blendv_ps(mean, blended, has_amaf);
+    }
+
+    __m256 score = _mm256_add_ps(mean, _mm256_div_ps(explore_v, _mm256_sqrt_ps(visits)));
+
+    // Proven children can't win
+    __m256i proven = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(block.proven + i)));
+    __m256 skip = _mm256_castsi256_ps(_mm256_cmpgt_epi32(proven, zero));
+    score = _mm256_blendv_ps(score, neg_inf, skip);
+
+    __m256 better = _mm256_andnot_ps(skip, _mm256_cmp_ps(score, best_score, _CMP_GT_OQ));
+    // A lane's first unskipped child wins even at -inf
+    better = _mm256_or_ps(better, _mm256_andnot_ps(skip,
+                 _mm256_castsi256_ps(_mm256_cmpeq_epi32(best_idx, _mm256_set1_epi32(-1)))));
+    best_score = _mm256_blendv_ps(best_score, score, better);
+    best_idx = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(best_idx),
+                                                    _mm256_castsi256_ps(idx), better));
+    idx = _mm256_add_epi32(idx, step);
+  }
+
+  alignas(32) float scores[8];
+  alignas(32) int32_t indices[8];
+  _mm256_store_ps(scores, best_score);
+  _mm256_store_si256(reinterpret_cast<__m256i*>(indices), best_idx);
+
+  size_t best = block.size;
+  float best_value = -std::numeric_limits<float>::infinity();
+  auto consider = [&](size_t index, float score) {
+    if(best == block.size || score > best_value || (score == best_value && index < best)) {
+      best_value = score;
+      best = index;
+    }
+  };
+
+  for(int lane = 0; lane < 8; ++lane) {
+    if(indices[lane] >= 0) consider(indices[lane], scores[lane]);
+  }
+
+  // Leftovers that don't fill a vector
+  for(; i < block.size; ++i) {
+    if(block.proven[i]) continue;
+    consider(i, uctScore(block, i, explore, rave));
+  }
+  return best;
+}
+
+#endif
+
+size_t uctArgmax(const UCTBlock& block, float explore, float rave) {
+#ifdef CHESS_HAVE_AVX2_KERNEL
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if(has_avx2 && block.size >= 8) return uctArgmaxAVX2(block, explore, rave);
+#endif
+  return uctArgmaxScalar(block, explore, rave);
+}
+
+}